@@ -0,0 +1,410 @@
+#ifndef DURABLERSTARTREE_HPP
+#define DURABLERSTARTREE_HPP
+
+#include "RStarTree.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+
+/////////////////////
+// DurableRStarTree
+/////////////////////
+
+// Optional durability layer for an in-memory RStarTree:
+//  - insert/remove are appended to a write-ahead log (<path>.log) and group-committed
+//    every groupSize operations (or on commit()).
+//  - checkpoint() writes every object to <path>.ckpt (atomically, through a rename) and
+//    starts an empty log, so the log only ever holds the tail since the last checkpoint.
+//  - commit() and checkpoint() return false when a write or sync fails (e.g., a full disk);
+//    nothing is acknowledged then, and the last checkpoint and the log are kept.
+//  - The constructor recovers: it bulk loads the checkpoint and replays the log tail. If
+//    either cannot be read, the tree stays closed (isOpen() is false) and the files are
+//    left untouched.
+// Payloads are written as raw bytes, so they must be trivially copyable.
+template <typename Payload = int64_t>
+class DurableRStarTree {
+    static_assert(is_trivially_copyable<Payload>::value, "Durable payloads must be trivially copyable");
+
+public:
+    enum Operation : uint8_t { INSERT = 1, REMOVE = 2 };
+
+    RStarTree<Payload> tree;
+    string path;
+    size_t groupSize;
+    uint64_t lastLSN;            // Sequence number of the last logged operation
+    uint64_t committedLSN;       // Operations up to here are on disk
+    vector<char> pending;        // Encoded records waiting for the next group commit
+    FILE* log;
+    long long crashAfterBytes;   // Crash injection: die after writing this many bytes (-1 = off)
+
+    DurableRStarTree(const string& path, int maxEntries, int dimensions, bool pointData = false, size_t groupSize = 64);
+    ~DurableRStarTree();
+    void insert(const Object<Payload>& object);
+    bool remove(const Object<Payload>& object);
+    bool commit();
+    bool checkpoint();
+    bool recover();
+    bool isOpen() const;
+    size_t recordSize() const;
+    void appendRecord(Operation op, const Object<Payload>& object);
+    bool decodeRecord(const char* record, Operation& op, uint64_t& lsn, Object<Payload>& object) const;
+    bool loadCheckpoint();
+    bool replayLog(long& validBytes);
+    void resetLog();
+    bool writeBytes(FILE* file, const void* data, size_t size);
+    static bool syncFile(FILE* file);
+    static void syncDirectory(const string& path);
+    static uint32_t checksum(const char* data, size_t size, uint32_t hash = 2166136261u);
+};
+
+template <typename Payload>
+DurableRStarTree<Payload>::DurableRStarTree(const string& path, int maxEntries, int dimensions, bool pointData, size_t groupSize)
+    : tree(maxEntries, dimensions, pointData), path(path), groupSize(groupSize),
+      lastLSN(0), committedLSN(0), log(nullptr), crashAfterBytes(-1) {
+    recover();
+}
+
+template <typename Payload>
+DurableRStarTree<Payload>::~DurableRStarTree() {
+    if (!log) return;
+    commit();
+    fclose(log);
+}
+
+template <typename Payload>
+void DurableRStarTree<Payload>::insert(const Object<Payload>& object) {
+    if (!log) {
+        cerr << "Error: " << path << " is not open" << endl;
+        return;
+    }
+    appendRecord(INSERT, object);
+    tree.insert(object);
+}
+
+template <typename Payload>
+bool DurableRStarTree<Payload>::remove(const Object<Payload>& object) {
+    if (!log) {
+        cerr << "Error: " << path << " is not open" << endl;
+        return false;
+    }
+    appendRecord(REMOVE, object);
+    return tree.remove(object);
+}
+
+// Group commit: one write and one fsync for all the pending records. On a failed write or
+// sync nothing is acknowledged: the partial group is cut off the log and stays pending, so
+// the next commit retries it whole.
+template <typename Payload>
+bool DurableRStarTree<Payload>::commit() {
+    if (pending.empty()) return true;
+    if (!log) return false;
+
+    off_t offset = lseek(fileno(log), 0, SEEK_END);
+    if (writeBytes(log, pending.data(), pending.size()) && syncFile(log)) {
+        pending.clear();
+        committedLSN = lastLSN;
+        return true;
+    }
+
+    // Closing drops whatever stdio still buffers, so nothing of the group reaches the log later
+    cerr << "Error: Could not commit to " << path << ".log" << endl;
+    fclose(log);
+    if (offset < 0 || truncate((path + ".log").c_str(), offset) != 0)
+        cerr << "Error: Could not cut the partial group off " << path << ".log" << endl;
+    log = fopen((path + ".log").c_str(), "ab");
+    return false;
+}
+
+// Writes a full snapshot next to the old one, renames it into place and truncates the log.
+// A crash before the rename keeps the old checkpoint; a crash after it leaves log records
+// that recovery skips, because their LSN is not newer than the checkpoint. If any write or
+// sync fails, the partial snapshot is deleted and the old checkpoint and the log stay as they are.
+template <typename Payload>
+bool DurableRStarTree<Payload>::checkpoint() {
+    if (!log || !commit()) return false;
+
+    string tmpPath = path + ".ckpt.tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        cerr << "Error: Could not write checkpoint " << tmpPath << endl;
+        return false;
+    }
+
+    uint32_t header[3] = {0x43545352, static_cast<uint32_t>(tree.dimensions), static_cast<uint32_t>(sizeof(Payload))}; // "RSTC"
+    uint64_t count = 0;
+    tree.forEachObject([&count](const Rectangle&, const Payload&) { ++count; });
+
+    bool written = writeBytes(file, header, sizeof(header)) && writeBytes(file, &lastLSN, sizeof(lastLSN))
+        && writeBytes(file, &count, sizeof(count));
+
+    uint32_t sum = checksum(nullptr, 0);
+    vector<char> chunk;
+    tree.forEachObject([&](const Rectangle& box, const Payload& payload) {
+        size_t offset = chunk.size();
+        chunk.resize(offset + sizeof(Payload) + 2 * tree.dimensions * sizeof(float));
+        char* out = chunk.data() + offset;
+        memcpy(out, &payload, sizeof(Payload));
+        memcpy(out + sizeof(Payload), box.minCoords.data(), tree.dimensions * sizeof(float));
+        memcpy(out + sizeof(Payload) + tree.dimensions * sizeof(float), box.maxCoords.data(), tree.dimensions * sizeof(float));
+
+        // Large sequential writes
+        if (chunk.size() >= (1 << 20)) {
+            sum = checksum(chunk.data(), chunk.size(), sum);
+            written = written && writeBytes(file, chunk.data(), chunk.size());
+            chunk.clear();
+        }
+    });
+    sum = checksum(chunk.data(), chunk.size(), sum);
+    written = written && writeBytes(file, chunk.data(), chunk.size()) && writeBytes(file, &sum, sizeof(sum));
+    written = written && syncFile(file);
+    written = fclose(file) == 0 && written;
+
+    if (!written) {
+        cerr << "Error: Could not write checkpoint " << tmpPath << endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    if (rename(tmpPath.c_str(), (path + ".ckpt").c_str()) != 0) {
+        cerr << "Error: Could not install checkpoint " << path << ".ckpt" << endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    // Make the rename durable before the log it replaces is emptied
+    syncDirectory(path);
+    resetLog();
+    return log != nullptr;
+}
+
+// Returns false, with the tree closed and the files untouched, if the checkpoint or the log cannot be read
+template <typename Payload>
+bool DurableRStarTree<Payload>::recover() {
+    if (log) fclose(log);
+    log = nullptr;
+    pending.clear();
+    lastLSN = 0;
+
+    delete tree.root;
+    tree.root = new typename RStarTree<Payload>::Node(true);
+    tree.buffer.clear();
+
+    long validBytes = 0;
+    if (!loadCheckpoint() || !replayLog(validBytes)) {
+        // Refuse to open: the log may still hold the only copy of acknowledged operations
+        cerr << "Error: Could not recover " << path << endl;
+        delete tree.root;
+        tree.root = new typename RStarTree<Payload>::Node(true);
+        lastLSN = committedLSN = 0;
+        return false;
+    }
+    committedLSN = lastLSN;
+
+    // Cut a torn or corrupt record off the end of the log and keep appending after the valid tail
+    if (truncate((path + ".log").c_str(), validBytes) != 0) {
+        if (errno != ENOENT) {
+            cerr << "Error: Could not truncate log " << path << ".log" << endl;
+            return false;
+        }
+        resetLog();
+        return log != nullptr;
+    }
+    log = fopen((path + ".log").c_str(), "ab");
+    if (!log) cerr << "Error: Could not open log " << path << ".log" << endl;
+    return log != nullptr;
+}
+
+template <typename Payload>
+bool DurableRStarTree<Payload>::isOpen() const {
+    return log != nullptr;
+}
+
+template <typename Payload>
+size_t DurableRStarTree<Payload>::recordSize() const {
+    return sizeof(uint8_t) + sizeof(uint64_t) + sizeof(Payload) + 2 * tree.dimensions * sizeof(float) + sizeof(uint32_t);
+}
+
+// Record layout: op, LSN, payload, min coordinates, max coordinates, checksum
+template <typename Payload>
+void DurableRStarTree<Payload>::appendRecord(Operation op, const Object<Payload>& object) {
+    size_t offset = pending.size();
+    pending.resize(offset + recordSize());
+    char* out = pending.data() + offset;
+    uint64_t lsn = ++lastLSN;
+    size_t coordBytes = tree.dimensions * sizeof(float);
+
+    out[0] = static_cast<char>(op);
+    memcpy(out + 1, &lsn, sizeof(lsn));
+    memcpy(out + 9, &object.payload, sizeof(Payload));
+    memcpy(out + 9 + sizeof(Payload), object.minCoords.data(), coordBytes);
+    memcpy(out + 9 + sizeof(Payload) + coordBytes, object.maxCoords.data(), coordBytes);
+    uint32_t sum = checksum(out, recordSize() - sizeof(uint32_t));
+    memcpy(out + recordSize() - sizeof(uint32_t), &sum, sizeof(sum));
+
+    if (pending.size() >= groupSize * recordSize())
+        commit();
+}
+
+template <typename Payload>
+bool DurableRStarTree<Payload>::decodeRecord(const char* record, Operation& op, uint64_t& lsn, Object<Payload>& object) const {
+    uint32_t sum;
+    memcpy(&sum, record + recordSize() - sizeof(uint32_t), sizeof(sum));
+    if (sum != checksum(record, recordSize() - sizeof(uint32_t))) return false;
+
+    size_t coordBytes = tree.dimensions * sizeof(float);
+    op = static_cast<Operation>(record[0]);
+    memcpy(&lsn, record + 1, sizeof(lsn));
+    memcpy(&object.payload, record + 9, sizeof(Payload));
+    object.minCoords.resize(tree.dimensions);
+    object.maxCoords.resize(tree.dimensions);
+    memcpy(object.minCoords.data(), record + 9 + sizeof(Payload), coordBytes);
+    memcpy(object.maxCoords.data(), record + 9 + sizeof(Payload) + coordBytes, coordBytes);
+    return op == INSERT || op == REMOVE;
+}
+
+// A missing checkpoint is a fresh tree; false means one exists but could not be loaded
+template <typename Payload>
+bool DurableRStarTree<Payload>::loadCheckpoint() {
+    FILE* file = fopen((path + ".ckpt").c_str(), "rb");
+    if (!file) {
+        if (errno == ENOENT) return true;
+        cerr << "Error: Could not read checkpoint " << path << ".ckpt" << endl;
+        return false;
+    }
+
+    uint32_t header[3];
+    uint64_t lsn, count;
+    bool valid = fread(header, sizeof(header), 1, file) == 1 && fread(&lsn, sizeof(lsn), 1, file) == 1 && fread(&count, sizeof(count), 1, file) == 1
+        && header[0] == 0x43545352 && header[1] == static_cast<uint32_t>(tree.dimensions) && header[2] == sizeof(Payload);
+
+    size_t objectSize = sizeof(Payload) + 2 * tree.dimensions * sizeof(float);
+    vector<char> data;
+    uint32_t sum = 0;
+    if (valid) {
+        // The count is checked against the file size before anything is allocated for it
+        long headerEnd = ftell(file);
+        fseek(file, 0, SEEK_END);
+        long fileSize = ftell(file);
+        fseek(file, headerEnd, SEEK_SET);
+        valid = count == (fileSize - headerEnd - sizeof(sum)) / objectSize;
+    }
+    if (valid) {
+        data.resize(count * objectSize);
+        valid = fread(data.data(), 1, data.size(), file) == data.size() && fread(&sum, sizeof(sum), 1, file) == 1;
+    }
+    fclose(file);
+
+    // Checkpoints are only ever installed complete, so a bad one means a foreign or damaged file
+    if (!valid || sum != checksum(data.data(), data.size())) {
+        cerr << "Error: Invalid checkpoint " << path << ".ckpt" << endl;
+        return false;
+    }
+
+    vector<Object<Payload>> objects(count);
+    size_t coordBytes = tree.dimensions * sizeof(float);
+    for (size_t i = 0; i < count; ++i) {
+        const char* in = data.data() + i * objectSize;
+        memcpy(&objects[i].payload, in, sizeof(Payload));
+        objects[i].minCoords.resize(tree.dimensions);
+        objects[i].maxCoords.resize(tree.dimensions);
+        memcpy(objects[i].minCoords.data(), in + sizeof(Payload), coordBytes);
+        memcpy(objects[i].maxCoords.data(), in + sizeof(Payload) + coordBytes, coordBytes);
+    }
+    // An empty checkpoint (every object removed) leaves the fresh empty tree as it is
+    if (count > 0) tree.bulkLoad(objects);
+    lastLSN = lsn;
+    return true;
+}
+
+// Replays the records newer than the checkpoint and stops at the first torn or corrupt one,
+// setting validBytes to the length of the log before it. Returns false if the log cannot be
+// read or skips past the checkpoint (a lost checkpoint), since nothing may be truncated then.
+template <typename Payload>
+bool DurableRStarTree<Payload>::replayLog(long& validBytes) {
+    validBytes = 0;
+    FILE* file = fopen((path + ".log").c_str(), "rb");
+    if (!file) {
+        if (errno == ENOENT) return true;
+        cerr << "Error: Could not read log " << path << ".log" << endl;
+        return false;
+    }
+
+    bool consistent = true;
+    vector<char> record(recordSize());
+    Object<Payload> object;
+    Operation op;
+    uint64_t lsn;
+
+    while (fread(record.data(), 1, record.size(), file) == record.size()) {
+        if (!decodeRecord(record.data(), op, lsn, object)) break;
+        if (lsn > lastLSN + 1) {
+            consistent = false;
+            break;
+        }
+        validBytes += record.size();
+        if (lsn <= lastLSN) continue;
+
+        if (op == INSERT)
+            tree.insert(object);
+        else
+            tree.remove(object);
+        lastLSN = lsn;
+    }
+    bool readError = ferror(file);
+    fclose(file);
+    if (!consistent) cerr << "Error: Log " << path << ".log does not continue the checkpoint" << endl;
+    return consistent && !readError;
+}
+
+template <typename Payload>
+void DurableRStarTree<Payload>::resetLog() {
+    if (log) fclose(log);
+    log = fopen((path + ".log").c_str(), "wb");
+    if (!log) {
+        cerr << "Error: Could not open log " << path << ".log" << endl;
+        return;
+    }
+    syncFile(log);
+}
+
+template <typename Payload>
+bool DurableRStarTree<Payload>::writeBytes(FILE* file, const void* data, size_t size) {
+    if (crashAfterBytes >= 0 && static_cast<long long>(size) > crashAfterBytes) {
+        // Simulated crash: a torn write, then the process dies without any cleanup
+        fwrite(data, 1, crashAfterBytes, file);
+        fflush(file);
+        _exit(3);
+    }
+    if (crashAfterBytes >= 0) crashAfterBytes -= size;
+
+    return fwrite(data, 1, size, file) == size;
+}
+
+template <typename Payload>
+bool DurableRStarTree<Payload>::syncFile(FILE* file) {
+    return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+template <typename Payload>
+void DurableRStarTree<Payload>::syncDirectory(const string& path) {
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(directory.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+// FNV-1a, which can be continued across chunks by passing the previous hash
+template <typename Payload>
+uint32_t DurableRStarTree<Payload>::checksum(const char* data, size_t size, uint32_t hash) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+#endif // DURABLERSTARTREE_HPP
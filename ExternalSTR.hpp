@@ -0,0 +1,599 @@
+#ifndef EXTERNALSTR_HPP
+#define EXTERNALSTR_HPP
+
+#include "RStarTree.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <memory>
+
+/////////////////////
+// IndexHeader
+/////////////////////
+
+// Layout of an index file written by ExternalSTRBuilder and read by MappedRStarTree:
+//  - this header, then the nodes, children before their parents, each starting 8-byte aligned
+//  - node: uint32 count, uint32 isLeaf, then count boxes (min and max corners; leaves of
+//    point trees store the min corner only), then, 8-byte aligned, the count payloads of
+//    a leaf or the count uint64 file offsets of an internal node's children
+// Everything is in host byte order, so the file can be mapped and read in place.
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dimensions;
+    uint32_t maxEntries;
+    uint32_t pointData;
+    uint32_t payloadSize;
+    uint64_t objects;
+    uint64_t nodes;
+    uint64_t root;      // File offset of the root node
+    uint32_t height;    // Levels, 1 for a single leaf
+    uint32_t reserved;
+};
+
+/////////////////////
+// ExternalSTRBuilder
+/////////////////////
+
+// Out-of-core bulk loading: builds the same STR tree as bulkLoad (same slabs, same leaves)
+// for inputs that do not fit in memory, and writes it straight into an index file.
+// Objects are records {payload, min corner, max corner}, read from a binary file of such
+// records or from a .stream file (rows "E id x y ..." become points).
+// Input that fits the memory budget is packed in memory. Otherwise it is cut into sorted
+// runs on the first axis, written to temporary files, and merged k ways (in several passes
+// if there are too many runs for the budget). The merged stream is cut into STR slabs, and
+// each slab is sorted on the next axis the same way, or in memory once it fits. Leaves are
+// written as soon as they are complete; only their MBRs (one per maxEntries objects) stay
+// in memory to pack the upper levels.
+template <typename Payload = int64_t>
+class ExternalSTRBuilder {
+    static_assert(is_trivially_copyable<Payload>::value, "Indexed payloads must be trivially copyable");
+
+public:
+    typedef function<size_t(char*, size_t)> Reader; // Reads up to n records into the buffer, returns how many
+    static constexpr uint32_t MAGIC = 0x58545352; // "RSTX"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t IO_BLOCK = 1 << 20;  // Unit of sequential I/O: the buffer per merged run and for staged writes
+
+    struct Run {
+        FILE* file;
+        size_t count;
+    };
+
+    RStarTree<Payload> layout; // Only its STR sort is used, so slabs match bulkLoad's
+    int maxEntries;
+    int dimensions;
+    bool pointData;
+    size_t memoryBudget;
+    string tempDir;
+
+    // Statistics of the last build
+    size_t objects;
+    size_t runs;
+    size_t merges;      // K-way merges, including the passes that combine runs beyond the fan-in
+    size_t tempBytes;
+    size_t nodes;
+
+    ExternalSTRBuilder(int maxEntries, int dimensions, bool pointData, size_t memoryBudget, const string& tempDir = "/tmp");
+    bool build(const string& inputPath, const string& indexPath);
+    bool build(Reader read, const string& indexPath);
+    size_t recordBytes() const;
+    size_t ioBlock(size_t budget) const;
+
+private:
+    FILE* index;
+    uint64_t offset;
+    vector<char> pendingLeaf;
+    vector<Rectangle> levelMBRs;
+    vector<uint64_t> levelOffsets;
+
+    float center(const char* record, int dim) const;
+    void buildSlab(Reader& read, int dim, size_t budget);
+    void packInMemory(vector<char>& records, size_t count, int dim);
+    void formRuns(Reader& read, int dim, size_t budget, vector<char>& records, size_t& count, vector<Run>& runsOut);
+    Run writeRun(const char* records, const vector<size_t>& perm, size_t block);
+    Reader merge(vector<Run>& sorted, int dim, size_t budget, vector<vector<char>>& buffers);
+    FILE* tempFile();
+    void emit(const char* record);
+    void writeLeaf(const char* records, size_t count);
+    void writeNode(const vector<char>& bytes);
+    uint64_t packUpperLevels();
+};
+
+template <typename Payload>
+ExternalSTRBuilder<Payload>::ExternalSTRBuilder(int maxEntries, int dimensions, bool pointData, size_t memoryBudget, const string& tempDir)
+    : layout(maxEntries, dimensions, pointData), maxEntries(maxEntries), dimensions(dimensions), pointData(pointData),
+      memoryBudget(memoryBudget), tempDir(tempDir), objects(0), runs(0), merges(0), tempBytes(0), nodes(0),
+      index(nullptr), offset(0) {}
+
+template <typename Payload>
+size_t ExternalSTRBuilder<Payload>::recordBytes() const {
+    return sizeof(Payload) + 2 * dimensions * sizeof(float);
+}
+
+// IO_BLOCK, or a quarter of the budget when that is smaller, in whole records
+template <typename Payload>
+size_t ExternalSTRBuilder<Payload>::ioBlock(size_t budget) const {
+    return max(recordBytes(), min(IO_BLOCK, budget / 4) / recordBytes() * recordBytes());
+}
+
+template <typename Payload>
+float ExternalSTRBuilder<Payload>::center(const char* record, int dim) const {
+    float low, high;
+    memcpy(&low, record + sizeof(Payload) + dim * sizeof(float), sizeof(float));
+    memcpy(&high, record + sizeof(Payload) + (dimensions + dim) * sizeof(float), sizeof(float));
+    return (low + high) / 2.0F;
+}
+
+template <typename Payload>
+bool ExternalSTRBuilder<Payload>::build(const string& inputPath, const string& indexPath) {
+    bool isStream = inputPath.size() >= 7 && inputPath.compare(inputPath.size() - 7, 7, ".stream") == 0;
+    if (!isStream) {
+        FILE* input = fopen(inputPath.c_str(), "rb");
+        if (!input) {
+            cerr << "Error: Could not open " << inputPath << endl;
+            return false;
+        }
+        setvbuf(input, nullptr, _IOFBF, IO_BLOCK);
+        bool built = build([this, input](char* out, size_t n) { return fread(out, recordBytes(), n, input); }, indexPath);
+        fclose(input);
+        return built;
+    }
+
+    if (dimensions != 2) {
+        cerr << "Error: .stream files hold 2-dimensional points" << endl;
+        return false;
+    }
+    ifstream input(inputPath);
+    if (!input.is_open()) {
+        cerr << "Error: Could not open " << inputPath << endl;
+        return false;
+    }
+    return build([&input](char* out, size_t n) {
+        string line;
+        size_t count = 0;
+        while (count < n && getline(input, line)) {
+            istringstream row(line);
+            char type;
+            int64_t id;
+            long x, y;
+            if (!(row >> type >> id >> x >> y) || type != 'E') continue;
+            Payload payload = static_cast<Payload>(id);
+            float coords[4] = {static_cast<float>(x), static_cast<float>(y), static_cast<float>(x), static_cast<float>(y)};
+            memcpy(out, &payload, sizeof(Payload));
+            memcpy(out + sizeof(Payload), coords, sizeof(coords));
+            out += sizeof(Payload) + sizeof(coords);
+            ++count;
+        }
+        return count;
+    }, indexPath);
+}
+
+template <typename Payload>
+bool ExternalSTRBuilder<Payload>::build(Reader read, const string& indexPath) {
+    index = fopen(indexPath.c_str(), "wb");
+    if (!index) {
+        cerr << "Error: Could not create index " << indexPath << endl;
+        return false;
+    }
+    setvbuf(index, nullptr, _IOFBF, IO_BLOCK);
+    objects = runs = merges = tempBytes = nodes = 0;
+    pendingLeaf.clear();
+    levelMBRs.clear();
+    levelOffsets.clear();
+
+    IndexHeader header = {};
+    fwrite(&header, sizeof(header), 1, index);
+    offset = sizeof(header);
+
+    buildSlab(read, 0, memoryBudget);
+    // An empty input still gets a root: a single empty leaf
+    if (!pendingLeaf.empty() || levelMBRs.empty())
+        writeLeaf(pendingLeaf.data(), pendingLeaf.size() / recordBytes());
+    pendingLeaf = vector<char>();
+
+    uint32_t height = 1;
+    for (size_t count = levelMBRs.size(); count > 1; count = (count + maxEntries - 1) / maxEntries)
+        ++height;
+    uint64_t root = packUpperLevels();
+
+    header = {MAGIC, VERSION, static_cast<uint32_t>(dimensions), static_cast<uint32_t>(maxEntries), pointData ? 1U : 0U,
+              static_cast<uint32_t>(sizeof(Payload)), objects, nodes, root, height, 0};
+    fseek(index, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, index);
+    bool written = !ferror(index);
+    written = fclose(index) == 0 && written;
+    index = nullptr;
+    if (!written) cerr << "Error: Could not write index " << indexPath << endl;
+    return written;
+}
+
+// Sorts everything read on dim and packs it: in memory if it fits the budget, else through
+// runs and a merge, cutting the merged stream into the slabs STR would cut
+template <typename Payload>
+void ExternalSTRBuilder<Payload>::buildSlab(Reader& read, int dim, size_t budget) {
+    vector<char> records;
+    vector<Run> sorted;
+    size_t count = 0;
+    formRuns(read, dim, budget, records, count, sorted);
+    if (sorted.empty()) {
+        packInMemory(records, count, dim);
+        return;
+    }
+    records = vector<char>();
+
+    // The last axis only needs the merged order; earlier ones leave half the budget to the slabs
+    bool lastAxis = dim + 1 >= dimensions;
+    size_t mergeBudget = lastAxis ? budget : budget / 2;
+    vector<vector<char>> buffers;
+    Reader merged = merge(sorted, dim, mergeBudget, buffers);
+
+    vector<char> record(recordBytes());
+    if (lastAxis) {
+        while (merged(record.data(), 1))
+            emit(record.data());
+        return;
+    }
+
+    size_t nodeCount = (count + maxEntries - 1) / maxEntries;
+    size_t slabCount = static_cast<size_t>(ceil(pow(static_cast<double>(nodeCount), 1.0 / (dimensions - dim))));
+    size_t slabSize = ((nodeCount + slabCount - 1) / slabCount) * maxEntries;
+    for (size_t start = 0; start < count; start += slabSize) {
+        size_t left = min(slabSize, count - start);
+        Reader slab = [&merged, &left](char* out, size_t n) {
+            size_t got = merged(out, min(n, left));
+            left -= got;
+            return got;
+        };
+        buildSlab(slab, dim + 1, budget - mergeBudget);
+    }
+}
+
+// STR over records that fit in memory, starting at axis dim
+template <typename Payload>
+void ExternalSTRBuilder<Payload>::packInMemory(vector<char>& records, size_t count, int dim) {
+    if (count == 0) return;
+    size_t bytes = recordBytes();
+    vector<size_t> perm(count);
+    iota(perm.begin(), perm.end(), 0);
+    layout.strSort(perm, 0, count, dim, [this, &records, bytes](size_t i, int d) {
+        return center(&records[i * bytes], d);
+    });
+    for (size_t i : perm)
+        emit(&records[i * bytes]);
+}
+
+// Reads the input in budget-sized chunks. A single chunk that holds everything is returned
+// unsorted in records; otherwise every chunk is sorted on dim and written as a run.
+template <typename Payload>
+void ExternalSTRBuilder<Payload>::formRuns(Reader& read, int dim, size_t budget, vector<char>& records, size_t& count, vector<Run>& runsOut) {
+    size_t bytes = recordBytes();
+    size_t block = ioBlock(budget);
+    size_t capacity = max<size_t>(maxEntries, (budget - block) / (bytes + sizeof(size_t)));
+    count = 0;
+
+    while (true) {
+        // Grown a block at a time, so small inputs do not pay for the whole budget
+        size_t got = 0, n = 1;
+        while (got < capacity && n > 0) {
+            records.resize((got + min(capacity - got, block / bytes)) * bytes);
+            n = read(&records[got * bytes], records.size() / bytes - got);
+            got += n;
+        }
+        count += got;
+        if (runsOut.empty() && got < capacity) {
+            records.resize(got * bytes);
+            return;
+        }
+        if (got == 0) return;
+
+        vector<size_t> perm(got);
+        iota(perm.begin(), perm.end(), 0);
+        sort(perm.begin(), perm.end(), [this, &records, bytes, dim](size_t a, size_t b) {
+            return center(&records[a * bytes], dim) < center(&records[b * bytes], dim);
+        });
+        runsOut.push_back(writeRun(records.data(), perm, block));
+        if (got < capacity) return;
+    }
+}
+
+template <typename Payload>
+typename ExternalSTRBuilder<Payload>::Run ExternalSTRBuilder<Payload>::writeRun(const char* records, const vector<size_t>& perm, size_t block) {
+    size_t bytes = recordBytes();
+    Run run = {tempFile(), perm.size()};
+    vector<char> staging;
+    staging.reserve(block);
+    for (size_t i : perm) {
+        staging.insert(staging.end(), records + i * bytes, records + (i + 1) * bytes);
+        if (staging.size() >= block) {
+            fwrite(staging.data(), 1, staging.size(), run.file);
+            staging.clear();
+        }
+    }
+    fwrite(staging.data(), 1, staging.size(), run.file);
+    tempBytes += perm.size() * bytes;
+    ++runs;
+    rewind(run.file);
+    return run;
+}
+
+// K-way merge of sorted runs on dim. Runs beyond what the budget can buffer (an I/O block each)
+// are first merged in groups into longer runs. The returned reader streams the merged
+// order, reading each run through its slice of the budget, and closes runs as they drain.
+template <typename Payload>
+typename ExternalSTRBuilder<Payload>::Reader ExternalSTRBuilder<Payload>::merge(vector<Run>& sorted, int dim, size_t budget, vector<vector<char>>& buffers) {
+    size_t bytes = recordBytes();
+    size_t block = ioBlock(budget);
+    size_t fanIn = max<size_t>(2, budget / block);
+
+    while (sorted.size() > fanIn) {
+        ++merges;
+        vector<Run> longer;
+        for (size_t first = 0; first < sorted.size(); first += fanIn) {
+            vector<Run> group(sorted.begin() + first, sorted.begin() + min(first + fanIn, sorted.size()));
+            size_t count = 0;
+            for (const auto& run : group) count += run.count;
+            vector<vector<char>> groupBuffers;
+            Reader groupReader = merge(group, dim, budget - block, groupBuffers);
+
+            Run run = {tempFile(), count};
+            vector<char> staging(block);
+            for (size_t n; (n = groupReader(staging.data(), staging.size() / bytes)) > 0;)
+                fwrite(staging.data(), bytes, n, run.file);
+            tempBytes += count * bytes;
+            rewind(run.file);
+            longer.push_back(run);
+        }
+        sorted = longer;
+    }
+    ++merges;
+
+    // Per run: its buffer, the next record, and the records left in the buffer
+    size_t perRun = max<size_t>(1, budget / sorted.size() / bytes);
+    buffers.assign(sorted.size(), vector<char>(perRun * bytes));
+    auto cursors = make_shared<vector<pair<size_t, size_t>>>(sorted.size(), make_pair(0, 0));
+    auto refill = [this, &buffers, sorted, cursors, perRun, bytes](size_t r) {
+        size_t got = fread(buffers[r].data(), bytes, perRun, sorted[r].file);
+        (*cursors)[r] = {0, got};
+        if (got == 0) fclose(sorted[r].file);
+        return got > 0;
+    };
+
+    typedef pair<float, size_t> Head; // Center of the run's next record, run
+    auto heads = make_shared<priority_queue<Head, vector<Head>, greater<Head>>>();
+    for (size_t r = 0; r < sorted.size(); ++r) {
+        if (refill(r)) heads->push({center(buffers[r].data(), dim), r});
+    }
+
+    return [this, &buffers, cursors, heads, refill, bytes, dim](char* out, size_t n) {
+        size_t count = 0;
+        for (; count < n && !heads->empty(); ++count) {
+            size_t r = heads->top().second;
+            heads->pop();
+            auto& cursor = (*cursors)[r];
+            memcpy(out + count * bytes, &buffers[r][cursor.first * bytes], bytes);
+            if (++cursor.first == cursor.second && !refill(r)) continue;
+            heads->push({center(&buffers[r][cursor.first * bytes], dim), r});
+        }
+        return count;
+    };
+}
+
+// An anonymous temporary file in tempDir, removed from the directory right away
+template <typename Payload>
+FILE* ExternalSTRBuilder<Payload>::tempFile() {
+    string name = tempDir + "/rstar-run-XXXXXX";
+    int fd = mkstemp(&name[0]);
+    FILE* file = fd < 0 ? nullptr : fdopen(fd, "w+b");
+    if (!file) {
+        cerr << "Error: Could not create a temporary file in " << tempDir << endl;
+        exit(1);
+    }
+    unlink(name.c_str());
+    return file;
+}
+
+// Appends a record to the current leaf, writing the leaf once it is full
+template <typename Payload>
+void ExternalSTRBuilder<Payload>::emit(const char* record) {
+    pendingLeaf.insert(pendingLeaf.end(), record, record + recordBytes());
+    ++objects;
+    if (pendingLeaf.size() == static_cast<size_t>(maxEntries) * recordBytes()) {
+        writeLeaf(pendingLeaf.data(), maxEntries);
+        pendingLeaf.clear();
+    }
+}
+
+template <typename Payload>
+void ExternalSTRBuilder<Payload>::writeLeaf(const char* records, size_t count) {
+    size_t bytes = recordBytes();
+    size_t stride = pointData ? dimensions : 2 * dimensions;
+    size_t coordBytes = count * stride * sizeof(float);
+    size_t payloadStart = (8 + coordBytes + 7) / 8 * 8;
+    vector<char> node(payloadStart + count * sizeof(Payload));
+    uint32_t head[2] = {static_cast<uint32_t>(count), 1};
+    memcpy(node.data(), head, sizeof(head));
+
+    Rectangle mbr(dimensions);
+    vector<float> coords(2 * dimensions);
+    for (size_t i = 0; i < count; ++i) {
+        const char* record = records + i * bytes;
+        memcpy(coords.data(), record + sizeof(Payload), coords.size() * sizeof(float));
+        for (int d = 0; d < dimensions; ++d) {
+            mbr.minCoords[d] = min(mbr.minCoords[d], coords[d]);
+            mbr.maxCoords[d] = max(mbr.maxCoords[d], coords[dimensions + d]);
+        }
+        memcpy(&node[8 + i * stride * sizeof(float)], coords.data(), stride * sizeof(float));
+        memcpy(&node[payloadStart + i * sizeof(Payload)], record, sizeof(Payload));
+    }
+    levelMBRs.push_back(mbr);
+    levelOffsets.push_back(offset);
+    writeNode(node);
+}
+
+template <typename Payload>
+void ExternalSTRBuilder<Payload>::writeNode(const vector<char>& bytes) {
+    static const char padding[8] = {};
+    fwrite(bytes.data(), 1, bytes.size(), index);
+    size_t pad = (8 - bytes.size() % 8) % 8;
+    fwrite(padding, 1, pad, index);
+    offset += bytes.size() + pad;
+    ++nodes;
+}
+
+// Packs the leaf MBRs level by level with STR, as packParents does, and returns the root
+template <typename Payload>
+uint64_t ExternalSTRBuilder<Payload>::packUpperLevels() {
+    while (levelMBRs.size() > 1) {
+        vector<size_t> perm(levelMBRs.size());
+        iota(perm.begin(), perm.end(), 0);
+        layout.strSort(perm, 0, perm.size(), 0, [this](size_t i, int dim) {
+            return (levelMBRs[i].minCoords[dim] + levelMBRs[i].maxCoords[dim]) / 2.0F;
+        });
+
+        vector<Rectangle> parentMBRs;
+        vector<uint64_t> parentOffsets;
+        for (size_t start = 0; start < perm.size(); start += maxEntries) {
+            size_t count = min(perm.size() - start, static_cast<size_t>(maxEntries));
+            size_t coordBytes = count * 2 * dimensions * sizeof(float);
+            size_t childStart = (8 + coordBytes + 7) / 8 * 8;
+            vector<char> node(childStart + count * sizeof(uint64_t));
+            uint32_t head[2] = {static_cast<uint32_t>(count), 0};
+            memcpy(node.data(), head, sizeof(head));
+
+            vector<Rectangle> children;
+            for (size_t i = 0; i < count; ++i) {
+                const Rectangle& mbr = levelMBRs[perm[start + i]];
+                char* box = &node[8 + i * 2 * dimensions * sizeof(float)];
+                memcpy(box, mbr.minCoords.data(), dimensions * sizeof(float));
+                memcpy(box + dimensions * sizeof(float), mbr.maxCoords.data(), dimensions * sizeof(float));
+                memcpy(&node[childStart + i * sizeof(uint64_t)], &levelOffsets[perm[start + i]], sizeof(uint64_t));
+                children.push_back(mbr);
+            }
+            parentMBRs.push_back(Rectangle::combine(children));
+            parentOffsets.push_back(offset);
+            writeNode(node);
+        }
+        levelMBRs = move(parentMBRs);
+        levelOffsets = move(parentOffsets);
+    }
+    return levelOffsets.front();
+}
+
+/////////////////////
+// MappedRStarTree
+/////////////////////
+
+// Read-only tree over an index file written by ExternalSTRBuilder. The file is mapped, not
+// loaded, so the operating system pages nodes in as queries touch them.
+template <typename Payload = int64_t>
+class MappedRStarTree {
+public:
+    int dimensions;
+    bool pointData;
+    IndexHeader header;
+
+    MappedRStarTree(const string& path);
+    ~MappedRStarTree();
+    MappedRStarTree(const MappedRStarTree&) = delete;
+    MappedRStarTree& operator=(const MappedRStarTree&) = delete;
+    bool isOpen() const;
+    vector<Object<Payload>> rangeQuery(const Rectangle& query) const;
+
+private:
+    const char* base;
+    size_t length;
+};
+
+template <typename Payload>
+MappedRStarTree<Payload>::MappedRStarTree(const string& path)
+    : dimensions(0), pointData(false), header(), base(nullptr), length(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(IndexHeader)) {
+        cerr << "Error: Could not open index " << path << endl;
+        if (fd >= 0) close(fd);
+        return;
+    }
+    length = info.st_size;
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        cerr << "Error: Could not map index " << path << endl;
+        length = 0;
+        return;
+    }
+
+    memcpy(&header, mapped, sizeof(header));
+    if (header.magic != ExternalSTRBuilder<Payload>::MAGIC || header.version != ExternalSTRBuilder<Payload>::VERSION ||
+        header.payloadSize != sizeof(Payload)) {
+        cerr << "Error: " << path << " is not an index of this payload type" << endl;
+        munmap(mapped, length);
+        length = 0;
+        return;
+    }
+    base = static_cast<const char*>(mapped);
+    dimensions = static_cast<int>(header.dimensions);
+    pointData = header.pointData != 0;
+}
+
+template <typename Payload>
+MappedRStarTree<Payload>::~MappedRStarTree() {
+    if (base) munmap(const_cast<char*>(base), length);
+}
+
+template <typename Payload>
+bool MappedRStarTree<Payload>::isOpen() const {
+    return base != nullptr;
+}
+
+template <typename Payload>
+vector<Object<Payload>> MappedRStarTree<Payload>::rangeQuery(const Rectangle& query) const {
+    vector<Object<Payload>> results;
+    if (!base) return results;
+    vector<uint64_t> stack = {header.root};
+
+    while (!stack.empty()) {
+        const char* node = base + stack.back();
+        stack.pop_back();
+        uint32_t head[2];
+        memcpy(head, node, sizeof(head));
+        uint32_t count = head[0];
+        bool isLeaf = head[1] != 0;
+        bool points = pointData && isLeaf;
+        size_t stride = points ? dimensions : 2 * dimensions;
+        const float* coords = reinterpret_cast<const float*>(node + 8);
+        const char* tail = node + (8 + count * stride * sizeof(float) + 7) / 8 * 8;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const float* minCoords = coords + i * stride;
+            const float* maxCoords = points ? minCoords : minCoords + dimensions;
+
+            bool overlaps = true;
+            for (int d = 0; d < dimensions && overlaps; ++d)
+                overlaps = query.minCoords[d] <= maxCoords[d] && query.maxCoords[d] >= minCoords[d];
+            if (!overlaps) continue;
+
+            if (isLeaf) {
+                Payload payload;
+                memcpy(&payload, tail + i * sizeof(Payload), sizeof(Payload));
+                vector<float> low(minCoords, minCoords + dimensions), high(maxCoords, maxCoords + dimensions);
+                results.emplace_back(payload, low, high);
+            } else {
+                uint64_t child;
+                memcpy(&child, tail + i * sizeof(uint64_t), sizeof(child));
+                stack.push_back(child);
+            }
+        }
+    }
+    return results;
+}
+
+#endif // EXTERNALSTR_HPP
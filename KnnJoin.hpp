@@ -0,0 +1,196 @@
+#ifndef KNNJOIN_HPP
+#define KNNJOIN_HPP
+
+#include "RStarTree.hpp"
+#include <thread>
+#include <atomic>
+
+/////////////////////
+// KnnJoin
+/////////////////////
+
+// One of the k nearest inner objects of an outer object. Distances are Euclidean, between
+// the closest points of the two boxes.
+template <typename Payload = int64_t>
+struct Neighbor {
+    Object<Payload> object;
+    float distance;
+};
+
+// Joins every object of outer with its k nearest objects of inner (fewer if inner is smaller):
+// callback(outerObject, neighbors) is called once per outer object, neighbors nearest first.
+// The outer tree is split into groups (one per leaf, plus its delta buffer), and each group
+// descends the inner tree once, best first by MINDIST from the group's MBR. A node pair is
+// pruned once its MINDIST exceeds the largest k-th distance found so far in the group, or
+// the MAXDIST to any inner node that is known to hold at least k objects (every member of
+// the group has k neighbours within that distance).
+// Groups are handed out to `threads` workers, so the callback must be thread-safe when
+// threads > 1. Trees with compressed leaves decode them in a shared scratch node, so they
+// are joined on one thread.
+template <typename OuterPayload, typename InnerPayload, typename Callback>
+void knnJoin(const RStarTree<OuterPayload>& outer, const RStarTree<InnerPayload>& inner, size_t k, Callback callback,
+             size_t threads = max(1U, thread::hardware_concurrency()));
+
+template <typename OuterPayload, typename InnerPayload, typename Callback>
+void allNearestNeighbors(const RStarTree<OuterPayload>& outer, const RStarTree<InnerPayload>& inner, Callback callback,
+                         size_t threads = max(1U, thread::hardware_concurrency()));
+
+// Squared distance from a box to a point stored inline in a point-data leaf
+inline float boxPointDistSq(const Rectangle& box, const float* point, int dimensions) {
+    float result = 0.0F;
+    for (int d = 0; d < dimensions; ++d) {
+        float delta = max(max(box.minCoords[d] - point[d], point[d] - box.maxCoords[d]), 0.0F);
+        result += delta * delta;
+    }
+    return result;
+}
+
+// The k nearest inner objects of every object in one outer group
+template <typename OuterPayload, typename InnerPayload, typename Callback>
+void knnJoinGroup(const vector<Object<OuterPayload>>& group, const RStarTree<InnerPayload>& inner, size_t k, Callback& callback) {
+    typedef BasicNode<InnerPayload> InnerNode;
+    struct Candidate {
+        float distSq;
+        const InnerNode* leaf;   // nullptr: inner.buffer[index]
+        size_t index;
+        bool operator<(const Candidate& other) const { return distSq < other.distSq; }
+    };
+    struct Pending {
+        float distSq;
+        const InnerNode* node;
+        const Rectangle* mbr;
+        bool operator<(const Pending& other) const { return distSq > other.distSq; }
+    };
+
+    const float infinity = numeric_limits<float>::max();
+    vector<priority_queue<Candidate>> best(group.size());
+    auto bound = [&](size_t a) { return best[a].size() < k ? infinity : best[a].top().distSq; };
+    auto offer = [&](size_t a, float distSq, const InnerNode* leaf, size_t index) {
+        if (best[a].size() < k) {
+            best[a].push({distSq, leaf, index});
+        } else if (distSq < best[a].top().distSq) {
+            best[a].pop();
+            best[a].push({distSq, leaf, index});
+        }
+    };
+    auto groupBound = [&]() {
+        float result = 0.0F;
+        for (size_t a = 0; a < group.size(); ++a)
+            result = max(result, bound(a));
+        return result;
+    };
+
+    Rectangle groupMBR = Rectangle::combine(vector<Rectangle>(group.begin(), group.end()));
+    for (size_t i = 0; i < inner.buffer.size(); ++i) {
+        for (size_t a = 0; a < group.size(); ++a)
+            offer(a, group[a].minDistSq(inner.buffer[i]), nullptr, i);
+    }
+
+    const InnerNode* root = inner.root;
+    Rectangle rootMBR = root && inner.leafSize(root) > 0 ? inner.nodeMBR(root) : Rectangle();
+    float guarantee = infinity;
+    priority_queue<Pending> pending;
+    if (root && inner.leafSize(root) > 0)
+        pending.push({groupMBR.minDistSq(rootMBR), root, &rootMBR});
+    float prune = groupBound();
+
+    while (!pending.empty() && pending.top().distSq <= min(prune, guarantee)) {
+        Pending item = pending.top();
+        pending.pop();
+
+        if (!item.node->isLeaf) {
+            for (size_t i = 0; i < item.node->children.size(); ++i) {
+                const Rectangle& mbr = item.node->entries[i];
+                const InnerNode* child = item.node->children[i];
+                // Every child below holds at least one object
+                size_t atLeast = child->isLeaf ? inner.leafSize(child) : child->children.size();
+                if (atLeast >= k)
+                    guarantee = min(guarantee, groupMBR.maxDistSq(mbr));
+                float distSq = groupMBR.minDistSq(mbr);
+                if (distSq <= min(prune, guarantee))
+                    pending.push({distSq, child, &mbr});
+            }
+            continue;
+        }
+
+        const InnerNode* leaf = inner.leafView(item.node);
+        size_t count = inner.leafSize(leaf);
+        for (size_t a = 0; a < group.size(); ++a) {
+            if (group[a].minDistSq(*item.mbr) > bound(a)) continue;
+            for (size_t j = 0; j < count; ++j) {
+                float distSq = inner.pointData ? boxPointDistSq(group[a], &leaf->points[j * inner.dimensions], inner.dimensions)
+                                               : group[a].minDistSq(leaf->entries[j]);
+                offer(a, distSq, item.node, j);
+            }
+        }
+        prune = groupBound();
+    }
+
+    vector<Candidate> found;
+    vector<Neighbor<InnerPayload>> neighbors;
+    for (size_t a = 0; a < group.size(); ++a) {
+        found.clear();
+        for (; !best[a].empty(); best[a].pop())
+            found.push_back(best[a].top());
+        neighbors.clear();
+        for (auto it = found.rbegin(); it != found.rend(); ++it) {
+            Object<InnerPayload> object = it->leaf ? inner.leafObject(it->leaf, it->index) : inner.buffer[it->index];
+            neighbors.push_back({object, sqrt(it->distSq)});
+        }
+        callback(group[a], neighbors);
+    }
+}
+
+template <typename OuterPayload, typename InnerPayload, typename Callback>
+void knnJoin(const RStarTree<OuterPayload>& outer, const RStarTree<InnerPayload>& inner, size_t k, Callback callback, size_t threads) {
+    if (k == 0) return;
+
+    vector<const BasicNode<OuterPayload>*> leaves;
+    function<void(const BasicNode<OuterPayload>*)> collect = [&](const BasicNode<OuterPayload>* node) {
+        if (node->isLeaf) {
+            if (outer.leafSize(node) > 0) leaves.push_back(node);
+            return;
+        }
+        for (const auto* child : node->children)
+            collect(child);
+    };
+    if (outer.root) collect(outer.root);
+
+    // Groups are numbered leaves first, then the buffer in leaf-sized slices
+    size_t bufferGroups = (outer.buffer.size() + outer.maxEntries - 1) / outer.maxEntries;
+    size_t groups = leaves.size() + bufferGroups;
+    if (outer.leavesCompressed || inner.leavesCompressed)
+        threads = 1;
+
+    atomic<size_t> next(0);
+    auto work = [&]() {
+        vector<Object<OuterPayload>> group;
+        for (size_t g = next++; g < groups; g = next++) {
+            group.clear();
+            if (g < leaves.size()) {
+                for (size_t i = 0; i < outer.leafSize(leaves[g]); ++i)
+                    group.push_back(outer.leafObject(leaves[g], i));
+            } else {
+                size_t first = (g - leaves.size()) * outer.maxEntries;
+                size_t last = min(first + outer.maxEntries, outer.buffer.size());
+                group.assign(outer.buffer.begin() + first, outer.buffer.begin() + last);
+            }
+            knnJoinGroup(group, inner, k, callback);
+        }
+    };
+
+    vector<thread> workers;
+    for (size_t t = 1; t < min(threads, groups); ++t)
+        workers.emplace_back(work);
+    work();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+// The nearest inner object of every outer object
+template <typename OuterPayload, typename InnerPayload, typename Callback>
+void allNearestNeighbors(const RStarTree<OuterPayload>& outer, const RStarTree<InnerPayload>& inner, Callback callback, size_t threads) {
+    knnJoin(outer, inner, 1, callback, threads);
+}
+
+#endif // KNNJOIN_HPP
@@ -0,0 +1,357 @@
+#ifndef MULTIVERSIONRSTARTREE_HPP
+#define MULTIVERSIONRSTARTREE_HPP
+
+#include "RStarTree.hpp"
+#include <memory>
+
+/////////////////////
+// MultiVersionRStarTree
+/////////////////////
+
+// Time-travel queries in the style of the Multiversion R-tree: every entry carries a validity
+// interval [start, end), and updates never overwrite the past. Operations arrive in time order:
+// insert(object, t) opens a version, remove(object, t) closes it (moving an object is both).
+//  - A node that overflows, or that falls below a quarter of its capacity in live entries, is
+//    version split at t: it stays unchanged for the past, its parent entry is closed at t, and
+//    its live entries are copied into a new node (merged with a live sibling's when there are
+//    too few, or cut in two by a key split when there are too many).
+//  - A root table maps time ranges to the root that was current then.
+//  - rangeQuery(box, t) and rangeQuery(box, from, to) only descend entries alive at the queried
+//    times. A query narrows its time window along the path, so every version is reported once
+//    even though version splits copy entries: by the copy whose window holds the first instant
+//    the version is alive in the query.
+template <typename Payload = int64_t>
+class MultiVersionRStarTree {
+public:
+    typedef int64_t Timestamp;
+    static constexpr Timestamp OPEN = numeric_limits<Timestamp>::max(); // End of a version that is still alive
+
+    struct Node;
+    struct Entry {
+        Rectangle box;
+        Timestamp start;
+        Timestamp end;
+        Node* child;        // Internal entries only
+        Payload payload;    // Leaf entries only
+    };
+    struct Node {
+        bool isLeaf;
+        vector<Entry> entries;
+        size_t alive() const;
+    };
+    struct Root {
+        Timestamp start;    // The root is current from start until the next root's start
+        Node* node;
+    };
+
+    int maxEntries;
+    int dimensions;
+    size_t weakMin;         // Fewer live entries trigger a version split (except at the root)
+    size_t strongMin;       // Fewer live entries after a version split trigger a merge with a sibling
+    size_t strongMax;       // More live entries after a version split trigger a key split
+    Timestamp now;          // Time of the latest operation
+    vector<Root> roots;
+    vector<unique_ptr<Node>> nodes; // Nodes are shared between versions, so the tree owns them all
+    size_t versionSplits;
+    size_t keySplits;
+    size_t merges;
+
+    MultiVersionRStarTree(int maxEntries, int dimensions);
+    void insert(const Object<Payload>& object, Timestamp time);
+    bool remove(const Object<Payload>& object, Timestamp time);
+    vector<Object<Payload>> rangeQuery(const Rectangle& box, Timestamp time) const;
+    vector<Object<Payload>> rangeQuery(const Rectangle& box, Timestamp from, Timestamp to) const;
+    float calculateSizeInMB() const;
+
+private:
+    bool advance(Timestamp time);
+    Node* newNode(bool isLeaf);
+    void insert(Node* node, const Entry& entry);
+    bool remove(Node* node, const Rectangle& box, const Payload& payload);
+    void restructure(Node* parent, size_t index);
+    vector<Entry> copyLive(vector<Entry>& live, bool isLeaf);
+    void settleRoot();
+    void newRoot(Node* root);
+    void query(const Node* node, const Rectangle& box, Timestamp low, Timestamp high, Timestamp from, vector<Object<Payload>>& results) const;
+    static Rectangle bounds(const vector<Entry>& entries);
+    static float enlargedArea(const Rectangle& a, const Rectangle& b);
+};
+
+template <typename Payload>
+size_t MultiVersionRStarTree<Payload>::Node::alive() const {
+    return count_if(entries.begin(), entries.end(), [](const Entry& entry) { return entry.end == OPEN; });
+}
+
+template <typename Payload>
+MultiVersionRStarTree<Payload>::MultiVersionRStarTree(int maxEntries, int dimensions)
+    : maxEntries(maxEntries), dimensions(dimensions), weakMin(max(1, maxEntries / 4)), strongMin(max(2, maxEntries * 3 / 8)),
+      strongMax(max(3, maxEntries * 3 / 4)), now(numeric_limits<Timestamp>::lowest()), versionSplits(0), keySplits(0), merges(0) {
+    roots.push_back({numeric_limits<Timestamp>::lowest(), newNode(true)});
+}
+
+template <typename Payload>
+typename MultiVersionRStarTree<Payload>::Node* MultiVersionRStarTree<Payload>::newNode(bool isLeaf) {
+    nodes.emplace_back(new Node{isLeaf, {}});
+    return nodes.back().get();
+}
+
+// Operations must arrive in time order, since the past is read-only
+template <typename Payload>
+bool MultiVersionRStarTree<Payload>::advance(Timestamp time) {
+    if (time < now) {
+        cerr << "Error: Operation at time " << time << " is older than the latest one (" << now << ")" << endl;
+        return false;
+    }
+    now = time;
+    return true;
+}
+
+template <typename Payload>
+void MultiVersionRStarTree<Payload>::insert(const Object<Payload>& object, Timestamp time) {
+    if (!advance(time)) return;
+    insert(roots.back().node, {object, time, OPEN, nullptr, object.payload});
+    settleRoot();
+}
+
+template <typename Payload>
+void MultiVersionRStarTree<Payload>::insert(Node* node, const Entry& entry) {
+    if (node->isLeaf) {
+        node->entries.push_back(entry);
+        return;
+    }
+
+    // Least enlargement among the live entries, as in chooseSubtree
+    size_t best = node->entries.size();
+    float bestIncrease = numeric_limits<float>::max(), bestArea = numeric_limits<float>::max();
+    for (size_t i = 0; i < node->entries.size(); ++i) {
+        if (node->entries[i].end != OPEN) continue;
+        float area = node->entries[i].box.getArea();
+        float increase = enlargedArea(node->entries[i].box, entry.box) - area;
+        if (increase < bestIncrease || (increase == bestIncrease && area < bestArea)) {
+            best = i;
+            bestIncrease = increase;
+            bestArea = area;
+        }
+    }
+
+    // Boxes only grow, so they stay valid for every version the entry covers
+    Node* child = node->entries[best].child;
+    Rectangle& box = node->entries[best].box;
+    for (int d = 0; d < dimensions; ++d) {
+        box.minCoords[d] = min(box.minCoords[d], entry.box.minCoords[d]);
+        box.maxCoords[d] = max(box.maxCoords[d], entry.box.maxCoords[d]);
+    }
+    insert(child, entry);
+    if (child->entries.size() > static_cast<size_t>(maxEntries))
+        restructure(node, best);
+}
+
+template <typename Payload>
+bool MultiVersionRStarTree<Payload>::remove(const Object<Payload>& object, Timestamp time) {
+    if (!advance(time)) return false;
+    if (!remove(roots.back().node, object, object.payload)) return false;
+    settleRoot();
+    return true;
+}
+
+template <typename Payload>
+bool MultiVersionRStarTree<Payload>::remove(Node* node, const Rectangle& box, const Payload& payload) {
+    for (size_t i = 0; i < node->entries.size(); ++i) {
+        Entry& entry = node->entries[i];
+        if (entry.end != OPEN) continue;
+        if (node->isLeaf) {
+            if (entry.box == box && entry.payload == payload) {
+                entry.end = now;
+                return true;
+            }
+            continue;
+        }
+        if (!entry.box.contains(box) || !remove(entry.child, box, payload)) continue;
+        Node* child = entry.child;
+        if (child->alive() < weakMin || child->entries.size() > static_cast<size_t>(maxEntries))
+            restructure(node, i);
+        return true;
+    }
+    return false;
+}
+
+// Version split of the child under parent->entries[index] at the current time
+template <typename Payload>
+void MultiVersionRStarTree<Payload>::restructure(Node* parent, size_t index) {
+    ++versionSplits;
+    Node* child = parent->entries[index].child;
+    parent->entries[index].end = now;
+    vector<Entry> live;
+    for (const auto& entry : child->entries)
+        if (entry.end == OPEN) live.push_back(entry);
+
+    // Too few live entries: take over the live entries of the closest live sibling
+    if (live.size() < strongMin) {
+        size_t sibling = parent->entries.size();
+        float closest = numeric_limits<float>::max();
+        Rectangle box = parent->entries[index].box;
+        for (size_t i = 0; i < parent->entries.size(); ++i) {
+            if (i == index || parent->entries[i].end != OPEN) continue;
+            float increase = enlargedArea(parent->entries[i].box, box) - parent->entries[i].box.getArea();
+            if (increase < closest) {
+                closest = increase;
+                sibling = i;
+            }
+        }
+        if (sibling < parent->entries.size()) {
+            ++merges;
+            parent->entries[sibling].end = now;
+            for (const auto& entry : parent->entries[sibling].child->entries)
+                if (entry.end == OPEN) live.push_back(entry);
+        }
+    }
+
+    for (const auto& copy : copyLive(live, child->isLeaf))
+        parent->entries.push_back(copy);
+}
+
+// Copies live entries into one new node, or two after a key split, and returns their parent entries
+template <typename Payload>
+vector<typename MultiVersionRStarTree<Payload>::Entry> MultiVersionRStarTree<Payload>::copyLive(vector<Entry>& live, bool isLeaf) {
+    vector<Entry> parents;
+    if (live.empty()) return parents;
+
+    size_t cut = live.size();
+    if (live.size() > strongMax) {
+        // Key split: halve along the axis with the widest spread of centers
+        ++keySplits;
+        int axis = 0;
+        float widest = -1.0F;
+        for (int d = 0; d < dimensions; ++d) {
+            auto bounds = minmax_element(live.begin(), live.end(), [d](const Entry& a, const Entry& b) {
+                return a.box.minCoords[d] + a.box.maxCoords[d] < b.box.minCoords[d] + b.box.maxCoords[d];
+            });
+            float spread = (bounds.second->box.minCoords[d] + bounds.second->box.maxCoords[d]) -
+                           (bounds.first->box.minCoords[d] + bounds.first->box.maxCoords[d]);
+            if (spread > widest) {
+                widest = spread;
+                axis = d;
+            }
+        }
+        sort(live.begin(), live.end(), [axis](const Entry& a, const Entry& b) {
+            return a.box.minCoords[axis] + a.box.maxCoords[axis] < b.box.minCoords[axis] + b.box.maxCoords[axis];
+        });
+        cut = live.size() / 2;
+    }
+
+    for (size_t first = 0; first < live.size(); first = cut, cut = live.size()) {
+        Node* node = newNode(isLeaf);
+        node->entries.assign(live.begin() + first, live.begin() + cut);
+        parents.push_back({bounds(node->entries), now, OPEN, node, Payload()});
+    }
+    return parents;
+}
+
+// Version splits the root when it overflows, and hands over to its only live child
+template <typename Payload>
+void MultiVersionRStarTree<Payload>::settleRoot() {
+    Node* root = roots.back().node;
+    if (root->entries.size() > static_cast<size_t>(maxEntries)) {
+        ++versionSplits;
+        vector<Entry> live;
+        for (const auto& entry : root->entries)
+            if (entry.end == OPEN) live.push_back(entry);
+        vector<Entry> copies = copyLive(live, root->isLeaf);
+        if (copies.size() == 1) {
+            newRoot(copies.front().child);
+        } else {
+            Node* above = newNode(false);
+            above->entries = copies;
+            newRoot(above);
+        }
+        return;
+    }
+    if (root->isLeaf) return;
+
+    size_t alive = root->alive();
+    if (alive == 0) {
+        newRoot(newNode(true));
+    } else if (alive == 1) {
+        for (const auto& entry : root->entries)
+            if (entry.end == OPEN) newRoot(entry.child);
+    }
+}
+
+// Later roots that start at the same time replace the earlier ones, whose versions were empty
+template <typename Payload>
+void MultiVersionRStarTree<Payload>::newRoot(Node* root) {
+    if (roots.back().start == now)
+        roots.back().node = root;
+    else
+        roots.push_back({now, root});
+}
+
+template <typename Payload>
+Rectangle MultiVersionRStarTree<Payload>::bounds(const vector<Entry>& entries) {
+    Rectangle result = entries.front().box;
+    for (const auto& entry : entries) {
+        for (size_t d = 0; d < result.minCoords.size(); ++d) {
+            result.minCoords[d] = min(result.minCoords[d], entry.box.minCoords[d]);
+            result.maxCoords[d] = max(result.maxCoords[d], entry.box.maxCoords[d]);
+        }
+    }
+    return result;
+}
+
+// Area of the box covering both, without building it
+template <typename Payload>
+float MultiVersionRStarTree<Payload>::enlargedArea(const Rectangle& a, const Rectangle& b) {
+    float area = 1.0F;
+    for (size_t d = 0; d < a.minCoords.size(); ++d)
+        area *= max(a.maxCoords[d], b.maxCoords[d]) - min(a.minCoords[d], b.minCoords[d]);
+    return area;
+}
+
+// Objects intersecting the box that were alive at the given time. Versions end before OPEN,
+// so none is alive at OPEN itself (and time + 1 would overflow).
+template <typename Payload>
+vector<Object<Payload>> MultiVersionRStarTree<Payload>::rangeQuery(const Rectangle& box, Timestamp time) const {
+    if (time == OPEN) return {};
+    return rangeQuery(box, time, time + 1);
+}
+
+// Versions intersecting the box that were alive at some time in [from, to). An object that
+// moved or was removed and inserted again in between is reported once per version.
+template <typename Payload>
+vector<Object<Payload>> MultiVersionRStarTree<Payload>::rangeQuery(const Rectangle& box, Timestamp from, Timestamp to) const {
+    vector<Object<Payload>> results;
+    for (size_t r = 0; r < roots.size(); ++r) {
+        Timestamp low = max(from, roots[r].start);
+        Timestamp high = min(to, r + 1 < roots.size() ? roots[r + 1].start : OPEN);
+        if (low < high) query(roots[r].node, box, low, high, from, results);
+    }
+    return results;
+}
+
+// Descends with the time window [low, high) narrowed to the entries on the path. A leaf entry
+// is reported only if the first instant it is alive in the query lies in the window.
+template <typename Payload>
+void MultiVersionRStarTree<Payload>::query(const Node* node, const Rectangle& box, Timestamp low, Timestamp high, Timestamp from, vector<Object<Payload>>& results) const {
+    for (const auto& entry : node->entries) {
+        Timestamp entryLow = max(low, entry.start), entryHigh = min(high, entry.end);
+        if (entryLow >= entryHigh || !box.overlapCheck(entry.box)) continue;
+
+        if (!node->isLeaf) {
+            query(entry.child, box, entryLow, entryHigh, from, results);
+            continue;
+        }
+        Timestamp first = max(from, entry.start);
+        if (entryLow <= first && first < entryHigh)
+            results.emplace_back(entry.box, entry.payload);
+    }
+}
+
+template <typename Payload>
+float MultiVersionRStarTree<Payload>::calculateSizeInMB() const {
+    size_t totalSize = roots.size() * sizeof(Root);
+    for (const auto& node : nodes)
+        totalSize += sizeof(Node) + sizeof(unique_ptr<Node>) + node->entries.size() * (sizeof(Entry) + 2 * dimensions * sizeof(float));
+    return static_cast<float>(totalSize) / (1024.0F * 1024.0F);
+}
+
+#endif // MULTIVERSIONRSTARTREE_HPP
@@ -7,27 +7,47 @@
 #include <iostream>
 #include <functional>
 #include <numeric>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <type_traits>
+#include <sstream>
+#include <unordered_map>
+#include <queue>
+#include <random>
 
 using namespace std;
 
+#if defined(__GNUC__) || defined(__clang__)
+#define RSTARTREE_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define RSTARTREE_PREFETCH(address) ((void)(address))
+#endif
+
 /////////////////////
 // Rectangle
 /////////////////////
 
 class Rectangle {
 public:
-    int id;
     vector<float> minCoords, maxCoords;
 
     Rectangle() = default;
     Rectangle(int dimensions);
-    Rectangle(const int id, const vector<float>& min, const vector<float>& max);
+    Rectangle(const vector<float>& min, const vector<float>& max);
     vector<float> getCenter() const;
     static Rectangle combine(const vector<Rectangle>& rectangles);
     float getArea() const;
     float getAreaIncrease(const Rectangle& other) const;
     float getOverlapArea(const Rectangle& other) const;
     bool overlapCheck(const Rectangle& other) const;
+    bool contains(const Rectangle& other) const;
+    bool isPoint() const;
+    float minDistSq(const vector<float>& point) const;
+    float maxDistSq(const vector<float>& point) const;
+    float minDistSq(const Rectangle& other) const;
+    float maxDistSq(const Rectangle& other) const;
     void printRectangle(const string& label) const;
     bool operator==(const Rectangle& other) const {
         return minCoords == other.minCoords && maxCoords == other.maxCoords;
@@ -35,12 +55,11 @@ public:
 };
 
 Rectangle::Rectangle(int dimensions)
-    : id(-1), 
-      minCoords(dimensions, numeric_limits<float>::max()),
+    : minCoords(dimensions, numeric_limits<float>::max()),
       maxCoords(dimensions, numeric_limits<float>::lowest()) {}
 
-Rectangle::Rectangle(const int id, const vector<float>& min, const vector<float>& max)
-    : id(id), minCoords(min), maxCoords(max) {}
+Rectangle::Rectangle(const vector<float>& min, const vector<float>& max)
+    : minCoords(min), maxCoords(max) {}
 
 float Rectangle::getArea() const {
     float result = 1.0F;
@@ -59,12 +78,14 @@ Rectangle Rectangle::combine(const vector<Rectangle>& rectangles) {
             combinedMax[i] = max(combinedMax[i], rect.maxCoords[i]);
         }
     }
-    return Rectangle(-1, combinedMin, combinedMax);
+    return Rectangle(combinedMin, combinedMax);
 }
 
 float Rectangle::getAreaIncrease(const Rectangle& other) const {
-    Rectangle combinedRect = combine({*this, other});
-    return combinedRect.getArea() - getArea();
+    float combinedArea = 1.0F;
+    for (size_t i = 0; i < minCoords.size(); ++i)
+        combinedArea *= max(maxCoords[i], other.maxCoords[i]) - min(minCoords[i], other.minCoords[i]);
+    return combinedArea - getArea();
 }
 
 float Rectangle::getOverlapArea(const Rectangle& other) const {
@@ -89,6 +110,58 @@ bool Rectangle::overlapCheck(const Rectangle& other) const {
     return true; 
 }
 
+bool Rectangle::isPoint() const {
+    return minCoords == maxCoords;
+}
+
+bool Rectangle::contains(const Rectangle& other) const {
+    for (size_t i = 0; i < minCoords.size(); ++i) {
+        if (other.minCoords[i] < minCoords[i] || other.maxCoords[i] > maxCoords[i])
+            return false;
+    }
+    return true;
+}
+
+// Squared distance from a point to the closest point of the rectangle (MINDIST)
+float Rectangle::minDistSq(const vector<float>& point) const {
+    float result = 0.0F;
+    for (size_t i = 0; i < minCoords.size(); ++i) {
+        float delta = max(max(minCoords[i] - point[i], point[i] - maxCoords[i]), 0.0F);
+        result += delta * delta;
+    }
+    return result;
+}
+
+// Squared distance from a point to the farthest corner of the rectangle
+float Rectangle::maxDistSq(const vector<float>& point) const {
+    float result = 0.0F;
+    for (size_t i = 0; i < minCoords.size(); ++i) {
+        float delta = max(point[i] - minCoords[i], maxCoords[i] - point[i]);
+        result += delta * delta;
+    }
+    return result;
+}
+
+// Squared distance between the closest points of two rectangles (0 when they overlap)
+float Rectangle::minDistSq(const Rectangle& other) const {
+    float result = 0.0F;
+    for (size_t i = 0; i < minCoords.size(); ++i) {
+        float delta = max(max(minCoords[i] - other.maxCoords[i], other.minCoords[i] - maxCoords[i]), 0.0F);
+        result += delta * delta;
+    }
+    return result;
+}
+
+// Squared distance between the farthest points of two rectangles
+float Rectangle::maxDistSq(const Rectangle& other) const {
+    float result = 0.0F;
+    for (size_t i = 0; i < minCoords.size(); ++i) {
+        float delta = max(maxCoords[i] - other.minCoords[i], other.maxCoords[i] - minCoords[i]);
+        result += delta * delta;
+    }
+    return result;
+}
+
 vector<float> Rectangle::getCenter() const {
     vector<float> center(minCoords.size());
     for (size_t i = 0; i < minCoords.size(); ++i)
@@ -97,10 +170,7 @@ vector<float> Rectangle::getCenter() const {
 }
 
 void Rectangle::printRectangle(const string& label) const {
-    cout << label << " [";
-    if (id != -1) // Print ID only if it is valid (not the default -1)
-        cout << "ID: " << id << ", ";
-    cout << "(";
+    cout << label << " [(";
     for (size_t i = 0; i < minCoords.size(); ++i) {
         cout << minCoords[i];
         if (i < minCoords.size() - 1) cout << ", ";
@@ -113,258 +183,941 @@ void Rectangle::printRectangle(const string& label) const {
     cout << ")]";
 }
 
+/////////////////////
+// Predicate
+/////////////////////
+
+// A spatial condition on objects. A query is the AND of a list of predicates.
+// Besides the per-object test, every predicate knows how to prune a node by its MBR
+// (mayMatch) and when all objects under an MBR are guaranteed to match (matchesAll).
+class Predicate {
+public:
+    enum Type { INTERSECTS, CONTAINS, WITHIN, DISTANCE_WITHIN };
+
+    Type type;
+    Rectangle box; // Query window, or the query point as a degenerate rectangle
+    float radius;
+
+    Predicate(Type type, const Rectangle& box, float radius = 0.0F);
+    static Predicate intersects(const Rectangle& box);
+    static Predicate contains(const Rectangle& box);
+    static Predicate within(const Rectangle& box);
+    static Predicate containsPoint(const vector<float>& point);
+    static Predicate withinDistance(const vector<float>& point, float radius);
+    bool matches(const Rectangle& entry) const;
+    bool matchesPoint(const float* point) const;
+    bool mayMatch(const Rectangle& mbr) const;
+    bool matchesAll(const Rectangle& mbr) const;
+};
+
+Predicate::Predicate(Type type, const Rectangle& box, float radius)
+    : type(type), box(box), radius(radius) {}
+
+Predicate Predicate::intersects(const Rectangle& box) {
+    return Predicate(INTERSECTS, box);
+}
+
+// Objects that fully contain the box
+Predicate Predicate::contains(const Rectangle& box) {
+    return Predicate(CONTAINS, box);
+}
+
+// Objects that lie fully inside the box
+Predicate Predicate::within(const Rectangle& box) {
+    return Predicate(WITHIN, box);
+}
+
+Predicate Predicate::containsPoint(const vector<float>& point) {
+    return Predicate(CONTAINS, Rectangle(point, point));
+}
+
+// Objects whose closest point is at most radius away from the point
+Predicate Predicate::withinDistance(const vector<float>& point, float radius) {
+    return Predicate(DISTANCE_WITHIN, Rectangle(point, point), radius);
+}
+
+bool Predicate::matches(const Rectangle& entry) const {
+    switch (type) {
+        case INTERSECTS: return box.overlapCheck(entry);
+        case CONTAINS: return entry.contains(box);
+        case WITHIN: return box.contains(entry);
+        case DISTANCE_WITHIN: return entry.minDistSq(box.minCoords) <= radius * radius;
+    }
+    return false;
+}
+
+// Point-specialized kernel for point leaves
+bool Predicate::matchesPoint(const float* point) const {
+    size_t dimensions = box.minCoords.size();
+
+    if (type == DISTANCE_WITHIN) {
+        float distSq = 0.0F;
+        for (size_t i = 0; i < dimensions; ++i) {
+            float delta = point[i] - box.minCoords[i];
+            distSq += delta * delta;
+        }
+        return distSq <= radius * radius;
+    }
+
+    for (size_t i = 0; i < dimensions; ++i) {
+        if (type == CONTAINS ? (point[i] != box.minCoords[i] || point[i] != box.maxCoords[i])
+                             : (point[i] < box.minCoords[i] || point[i] > box.maxCoords[i]))
+            return false;
+    }
+    return true;
+}
+
+bool Predicate::mayMatch(const Rectangle& mbr) const {
+    switch (type) {
+        case INTERSECTS:
+        case WITHIN: return box.overlapCheck(mbr);
+        case CONTAINS: return mbr.contains(box);
+        case DISTANCE_WITHIN: return mbr.minDistSq(box.minCoords) <= radius * radius;
+    }
+    return false;
+}
+
+bool Predicate::matchesAll(const Rectangle& mbr) const {
+    switch (type) {
+        case INTERSECTS:
+        case WITHIN: return box.contains(mbr);
+        case CONTAINS: return false;
+        case DISTANCE_WITHIN: return mbr.maxDistSq(box.minCoords) <= radius * radius;
+    }
+    return false;
+}
+
+/////////////////////
+// Object
+/////////////////////
+
+// A data object: its bounding box plus the payload stored inline in the leaf.
+// The payload is a 64-bit id by default, but it can be any copyable type
+// (e.g., a small struct) or NoPayload when nothing needs to be stored.
+struct NoPayload {};
+
+inline bool operator==(const NoPayload&, const NoPayload&) { return true; }
+
+template <typename Payload = int64_t>
+class Object : public Rectangle {
+public:
+    Payload payload;
+
+    Object() = default;
+    Object(const Payload& payload, const vector<float>& min, const vector<float>& max);
+    Object(const Rectangle& box, const Payload& payload);
+};
+
+template <typename Payload>
+Object<Payload>::Object(const Payload& payload, const vector<float>& min, const vector<float>& max)
+    : Rectangle(min, max), payload(payload) {}
+
+template <typename Payload>
+Object<Payload>::Object(const Rectangle& box, const Payload& payload)
+    : Rectangle(box), payload(payload) {}
+
+// Payload types with a std::hash. Only those can have an update index; the tree only
+// touches the index behind this trait, so NoPayload and plain structs still compile.
+template <typename Payload, typename = void>
+struct isHashable : false_type {};
+
+template <typename Payload>
+struct isHashable<Payload, void_t<decltype(hash<Payload>()(declval<const Payload&>()))>> : true_type {};
+
+// Hashes payloads for the update index
+struct PayloadHash {
+    template <typename Payload>
+    size_t operator()(const Payload& payload) const { return hash<Payload>()(payload); }
+};
+
+// Leaf payloads, kept aligned with the leaf entries. Internal nodes leave it empty,
+// and empty payload types only keep a count, so neither pays per entry.
+template <typename Payload, bool = is_empty<Payload>::value>
+class PayloadStore : public vector<Payload> {
+public:
+    void swapAt(size_t i, size_t j) { swap((*this)[i], (*this)[j]); }
+};
+
+template <typename Payload>
+class PayloadStore<Payload, true> {
+public:
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void push_back(const Payload&) { ++count; }
+    void pop_back() { --count; }
+    void resize(size_t n) { count = n; }
+    void clear() { count = 0; }
+    void reserve(size_t) {}
+    void swapAt(size_t, size_t) {}
+    Payload operator[](size_t) const { return Payload(); }
+};
+
 /////////////////////
 // Node
 /////////////////////
 
-class Node {
+template <typename Payload>
+class BasicNode {
 public:
     bool isLeaf;
     vector<Rectangle> entries;
-    vector<Node*> children;
-
-    Node(bool isLeaf);
-    Node(const vector<Rectangle>& entries);
-    ~Node();
+    vector<BasicNode*> children;
+    PayloadStore<Payload> payloads;
+    vector<float> points; // Leaf coordinates (one tuple per entry) when the tree holds points
+    bool packed; // Built by STR and not modified since, so re-packing it would gain nothing
+    BasicNode* parent; // Maintained by the update index only
+    vector<uint8_t> compressed; // Encoded leaf contents after compressLeaves(); entries, points, and payloads are then empty
+    float maxScore; // Upper bound on the scores in the subtree, kept only while the tree has a score function
+
+    BasicNode(bool isLeaf);
+    BasicNode(typename vector<Object<Payload>>::const_iterator first, typename vector<Object<Payload>>::const_iterator last, bool pointData = false);
+    ~BasicNode();
 };
 
-Node::Node(bool isLeaf)
-    : isLeaf(isLeaf) {}
-
-Node::Node(const vector<Rectangle>& rects)
-    : isLeaf(true), entries(rects) {}
+template <typename Payload>
+BasicNode<Payload>::BasicNode(bool isLeaf)
+    : isLeaf(isLeaf), packed(false), parent(nullptr), maxScore(-numeric_limits<float>::infinity()) {}
+
+template <typename Payload>
+BasicNode<Payload>::BasicNode(typename vector<Object<Payload>>::const_iterator first, typename vector<Object<Payload>>::const_iterator last, bool pointData)
+    : isLeaf(true), packed(false), parent(nullptr), maxScore(-numeric_limits<float>::infinity()) {
+    if (!pointData) entries.reserve(last - first);
+    for (auto it = first; it != last; ++it) {
+        if (pointData) {
+            assert(it->isPoint() && "point data trees only hold degenerate boxes");
+            points.insert(points.end(), it->minCoords.begin(), it->minCoords.end());
+        }
+        else
+            entries.push_back(*it);
+        payloads.push_back(it->payload);
+    }
+}
 
-Node::~Node() {
+template <typename Payload>
+BasicNode<Payload>::~BasicNode() {
     for (auto* child : children)
         delete child;
 }
 
+/////////////////////
+// TreeStats
+/////////////////////
+
+// Shape of one tree level (depth 0 is the root). Areas are summed over the nodes of the level.
+struct LevelStats {
+    int depth = 0;
+    bool leaves = false;
+    size_t nodes = 0;
+    size_t entries = 0;
+    float minFill = 1.0F, avgFill = 0.0F, maxFill = 0.0F;
+    vector<size_t> fillHistogram = vector<size_t>(10, 0); // Nodes per 10% fill-factor bucket
+    double area = 0.0;       // Node MBR area
+    double overlap = 0.0;    // Pairwise overlap between sibling MBRs
+    double deadSpace = 0.0;  // MBR area not covered by the node's entries
+    double margin = 0.0;     // Sum of MBR edge lengths
+};
+
+class TreeStats {
+public:
+    size_t objects = 0;
+    vector<LevelStats> levels;
+
+    void print(ostream& out) const;
+    string toCSV() const;
+    string toJSON() const;
+};
+
+void TreeStats::print(ostream& out) const {
+    out << "   Height: " << levels.size() << ", objects: " << objects << endl;
+    for (const auto& level : levels) {
+        out << "   Level " << level.depth << (level.leaves ? " (leaves)" : "") << ": " << level.nodes << " nodes, "
+            << "fill " << level.minFill << "/" << level.avgFill << "/" << level.maxFill << " (min/avg/max), "
+            << "overlap " << level.overlap << ", dead space " << level.deadSpace << ", margin " << level.margin << endl;
+    }
+}
+
+string TreeStats::toCSV() const {
+    ostringstream out;
+    out << "depth,leaves,nodes,entries,min_fill,avg_fill,max_fill,area,overlap,dead_space,margin";
+    for (int b = 0; b < 10; ++b) out << ",fill_" << b * 10 << "_" << (b + 1) * 10;
+    out << "\n";
+
+    for (const auto& level : levels) {
+        out << level.depth << "," << level.leaves << "," << level.nodes << "," << level.entries << ","
+            << level.minFill << "," << level.avgFill << "," << level.maxFill << ","
+            << level.area << "," << level.overlap << "," << level.deadSpace << "," << level.margin;
+        for (size_t count : level.fillHistogram) out << "," << count;
+        out << "\n";
+    }
+    return out.str();
+}
+
+string TreeStats::toJSON() const {
+    ostringstream out;
+    out << "{\"objects\": " << objects << ", \"levels\": [";
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const LevelStats& level = levels[i];
+        out << (i ? ", " : "") << "{\"depth\": " << level.depth << ", \"leaves\": " << (level.leaves ? "true" : "false")
+            << ", \"nodes\": " << level.nodes << ", \"entries\": " << level.entries
+            << ", \"min_fill\": " << level.minFill << ", \"avg_fill\": " << level.avgFill << ", \"max_fill\": " << level.maxFill
+            << ", \"area\": " << level.area << ", \"overlap\": " << level.overlap
+            << ", \"dead_space\": " << level.deadSpace << ", \"margin\": " << level.margin << ", \"fill_histogram\": [";
+        for (size_t b = 0; b < level.fillHistogram.size(); ++b)
+            out << (b ? ", " : "") << level.fillHistogram[b];
+        out << "]}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+// Approximate result size of a range query. [lowGuess, highGuess] is a heuristic spread, not a
+// bound: unexpanded subtrees are counted at typicalSubtreeSizes(), so the true count can fall
+// outside it when subtree sizes vary. Only once every partially covered node has been expanded
+// down to its leaves is estimate == lowGuess == highGuess exact.
+struct CountEstimate {
+    double estimate = 0.0;
+    double lowGuess = 0.0;
+    double highGuess = 0.0;
+    size_t nodesVisited = 0;
+};
+
+// Scratch of one level of a batched range query: the queries still active at a node, their
+// bounds as one array per coordinate, the box covering them all (lows, then highs), and which
+// of them hit the entry being tested. One is kept per depth and reused by every node there.
+struct BatchLevel {
+    vector<uint32_t> active;
+    vector<float> bounds;
+    vector<float> cover;
+    vector<unsigned char> hits;
+};
+
 /////////////////////
 // RStarTree
 ////////////////////
 
+template <typename Payload>
+class QueryCursor;
+
+template <typename Payload = int64_t>
+class CompactTree;
+
+template <typename Payload = int64_t>
 class RStarTree {
 public:
+    using Node = BasicNode<Payload>;
+
+    // Range query engines: recursive depth-first descent, or a breadth-first sweep that
+    // prefetches the frontier ahead of processing to overlap cache misses across siblings
+    enum Traversal { DEPTH_FIRST, PREFETCH_BREADTH_FIRST };
+    static const size_t PREFETCH_DISTANCE = 8;
+
     Node* root;
     int maxEntries;
     int minEntries;
     int dimensions;
-
-    RStarTree(int maxEntries, int dimensions);
+    bool pointData;
+    vector<Object<Payload>> buffer;
+    size_t bufferCapacity;
+    unordered_map<Payload, Node*, PayloadHash> leafOf; // Update index: object id -> leaf holding it
+    bool updateIndexEnabled;
+    bool updateIndexStale;
+    float updateSlack;
+    Traversal traversal;
+    bool leavesCompressed;
+    mutable Node decodedLeaf;        // Last compressed leaf decoded by leafView()
+    mutable const Node* decodedFrom;
+    function<float(const Payload&)> score; // Per-object score for topK(), see enableScores()
+    vector<pair<Node*, size_t>> insertPath; // Scratch for insert(): (node, child taken) from the top down
+    mutable vector<size_t> splitOrder;      // Scratch for splits: entry order along an axis
+    mutable vector<float> splitBounds;      // Scratch for splits: MBRs of the prefixes and suffixes of splitOrder
+
+    RStarTree(int maxEntries, int dimensions, bool pointData = false);
     ~RStarTree();
-    void insert(const Rectangle& entry);
-    void insert(Node* currentNode, const Rectangle& entry, bool allowReinsertion);
-    void batchInsert(vector<Rectangle>& rectangles);
+    void insert(const Object<Payload>& object);
+    void insert(Object<Payload>&& object);
+    template <typename Entry>
+    bool insert(Node* currentNode, Entry&& entry, const Payload& payload);
+    void splitRoot();
+    void batchInsert(vector<Object<Payload>>& objects);
     Node* insertNode(Node* currentNode, Node* newNode);
-    void bulkLoad(vector<Rectangle>& rectangles);
-    void recursiveSTRSort(vector<Rectangle>& rects, int dim, int maxDim);
-    void reinsert(Node* node);
-    static Node* chooseSubtree(Node* currentNode, const Rectangle& entry, bool isBatch);
+    void bulkLoad(vector<Object<Payload>>& objects);
+    void bulkLoad(const vector<const float*>& columns, const Payload* payloads, size_t count, size_t stride = 1);
+    vector<Node*> packObjects(const vector<Object<Payload>>& objects);
+    template <typename Center, typename Fill>
+    vector<Node*> packSTR(size_t count, const Center& center, const Fill& fill);
+    template <typename Center>
+    void strSort(vector<size_t>& perm, size_t first, size_t last, int dim, const Center& center) const;
+    void packLevels(vector<Node*>& nodes);
+    vector<Node*> packParents(const vector<Node*>& nodes) const;
+    size_t optimize(size_t budget, double minScore = 0.0);
+    void repack(Node* node, int height);
+    double repackScore(const Node* node) const;
+    void enableBuffering(size_t capacity);
+    void bufferedInsert(const Object<Payload>& object);
+    void flushBuffer();
+    bool remove(const Object<Payload>& object);
+    bool remove(Node* node, const Rectangle& entry, const Payload& payload, vector<Object<Payload>>& orphans);
+    size_t removeRange(const Rectangle& box);
+    template <typename Filter>
+    size_t removeRange(const Rectangle& box, Filter filter);
+    template <typename Filter>
+    size_t removeRange(const Rectangle& box, Filter& filter, bool filtered);
+    template <typename Filter>
+    size_t removeRange(Node* node, const Rectangle& box, Filter& filter, bool filtered, vector<Object<Payload>>& orphans);
+    bool leafEntryEquals(const Node* leaf, size_t index, const Rectangle& entry) const;
+    void removeLeafEntry(Node* leaf, size_t index) const;
+    void enableUpdates(float slack = 0.0F);
+    bool update(const Payload& id, const Rectangle& oldBox, const Rectangle& newBox);
+    void rebuildUpdateIndex();
+    size_t childIndex(const Node* parent, const Node* child) const;
+    void setLeafEntry(Node* leaf, size_t index, const Rectangle& box) const;
+    void compressLeaves();
+    void decompressLeaves();
+    const Node* leafView(const Node* leaf) const;
+    vector<uint8_t> encodeLeaf(const Node* leaf) const;
+    void decodeLeaf(const vector<uint8_t>& bytes, Node& leaf) const;
+    static uint32_t floatKey(float value);
+    static float keyFloat(uint32_t key);
+    static void putVarint(vector<uint8_t>& bytes, uint64_t value);
+    static uint64_t getVarint(const uint8_t*& in);
+    void enableScores(function<float(const Payload&)> scoreOf);
+    void refreshMaxScore(Node* node) const;
+    vector<Object<Payload>> topK(const Rectangle& box, size_t k) const;
+    static size_t chooseSubtree(const Node* currentNode, const Rectangle& entry, bool isBatch);
+    bool extend(Rectangle& mbr, const Rectangle& entry) const;
+    bool touches(const Rectangle& mbr, const Rectangle& entry) const;
+    bool overflowing(const Node* node) const;
+    void attachSibling(Node* parent, size_t index, Node* sibling);
+    void adopt(Node* parent, Node* sibling);
     Node* splitNode(Node* node) const;
-    void chooseBestSplit(const vector<Rectangle>& sortedEntries, vector<size_t>& sortedIndices, size_t& bestAxis, size_t& bestSplitIndex) const;
-    static void sortEntriesAndChildren(Node* node, const vector<Rectangle>& sortedEntries, vector<size_t>& sortedIndices, size_t bestAxis);
-    static void updateRectangles(Node* node);
-    vector<Rectangle> rangeQuery(const Rectangle& query);
-    void rangeQuery(Node* node, const Rectangle& query, vector<Rectangle>& results);
+    Node* splitOff(Node* node) const;
+    float splitCoord(const Node* node, size_t i, int d, bool upper) const;
+    void sortSplitOrder(const Node* node, int axis) const;
+    void chooseBestSplit(const Node* node, size_t& bestAxis, size_t& bestSplitIndex) const;
+    void sortEntriesAndChildren(Node* node, size_t bestAxis) const;
+    size_t leafSize(const Node* node) const;
+    Rectangle nodeMBR(const Node* node) const;
+    bool pointInBox(const float* point, const Rectangle& box) const;
+    vector<Object<Payload>> rangeQuery(const Rectangle& query);
+    void rangeQuery(Node* node, const Rectangle& query, vector<Object<Payload>>& results);
+    void rangeQueryPrefetch(const Rectangle& query, vector<Object<Payload>>& results);
+    void prefetchArrays(const Node* node) const;
+    void prefetchCoordinates(const Node* node) const;
+    vector<vector<Object<Payload>>> rangeQueryBatch(const vector<Rectangle>& queries) const;
+    void rangeQueryBatch(const Node* node, size_t depth, vector<BatchLevel>& levels, vector<vector<Object<Payload>>>& results) const;
+    static uint64_t hilbertKey(uint32_t x, uint32_t y);
+    vector<Object<Payload>> query(const vector<Predicate>& predicates);
+    void query(Node* node, const vector<Predicate>& predicates, vector<Object<Payload>>& results);
+    QueryCursor<Payload> cursor(const Rectangle& query) const;
+    QueryCursor<Payload> cursor(const vector<Predicate>& predicates) const;
+    CompactTree<Payload> compact(typename CompactTree<Payload>::Layout layout) const;
+    bool leafEntryMatches(const Node* leaf, size_t index, const vector<Predicate>& predicates) const;
+    Object<Payload> leafObject(const Node* leaf, size_t index) const;
+    template <typename Visitor>
+    void forEachObject(Visitor visit) const;
+    template <typename Visitor>
+    void forEachObject(const Node* node, Visitor&& visit) const;
     float calculateSizeInMB() const;
+    TreeStats analyze() const;
+    double deadSpace(const Node* node, const Rectangle& mbr) const;
+    double expectedNodeAccesses(const vector<float>& querySize) const;
+    CountEstimate estimateCount(const Rectangle& box, int maxDepth = 2, double errorBound = 0.1) const;
+    vector<double> typicalSubtreeSizes() const;
+    double coverage(const Rectangle& entry, const Rectangle& box) const;
+    template <typename Rng>
+    vector<Object<Payload>> sample(const Rectangle& box, size_t k, Rng& rng);
 
 };
 
-RStarTree::RStarTree(int maxEntries, int dimensions)
-    : maxEntries(maxEntries), minEntries(maxEntries / 2), dimensions(dimensions) {
+// With pointData, leaves keep only the min corner of each object, so every object must be a
+// degenerate box (minCoords == maxCoords); debug builds assert it on insertion and bulk loading.
+template <typename Payload>
+RStarTree<Payload>::RStarTree(int maxEntries, int dimensions, bool pointData)
+    : maxEntries(maxEntries), minEntries(maxEntries / 2), dimensions(dimensions), pointData(pointData), bufferCapacity(0),
+      updateIndexEnabled(false), updateIndexStale(false), updateSlack(0.0F), traversal(DEPTH_FIRST),
+      leavesCompressed(false), decodedLeaf(true), decodedFrom(nullptr) {
     root = new Node(true);
 }
 
-RStarTree::~RStarTree() {
+template <typename Payload>
+RStarTree<Payload>::~RStarTree() {
     delete root;
 }
 
-void RStarTree::insert(const Rectangle& entry) {
+template <typename Payload>
+void RStarTree<Payload>::insert(const Object<Payload>& object) {
+    decompressLeaves();
     if (!root) root = new Node(true);
-    insert(root, entry, true);
+    insert(root, object, object.payload);
+    splitRoot();
 }
 
-void RStarTree::insert(Node* currentNode, const Rectangle& entry, bool allowReinsertion) {
-    if (!currentNode) return;
-    
-    if (currentNode->isLeaf) {
-        currentNode->entries.push_back(entry);
-        
-        if (currentNode->entries.size() > maxEntries) {
-            if (allowReinsertion)
-                reinsert(currentNode);
-            else {
-                Node* newRoot = splitNode(currentNode);
-                if (currentNode == root)
-                    root = newRoot;
-            }
+// Moves the object's coordinates into its leaf, so inserts that split no node allocate nothing
+template <typename Payload>
+void RStarTree<Payload>::insert(Object<Payload>&& object) {
+    decompressLeaves();
+    if (!root) root = new Node(true);
+    insert(root, static_cast<Rectangle&&>(object), object.payload);
+    splitRoot();
+}
+
+template <typename Payload>
+void RStarTree<Payload>::splitRoot() {
+    if (!overflowing(root)) return;
+    Node* oldRoot = root;
+    root = splitNode(oldRoot);
+    oldRoot->parent = root;
+    adopt(root, root->children.back());
+}
+
+// Inserts below currentNode and returns whether the entry of currentNode would have to grow.
+// The path is recorded on the way down. On the way up, each level only grows the entry of the
+// child it descended into, stopping at the first one that already covers the new entry, and
+// overflowing children are split here, where the sibling has a parent to go to. The entry is
+// moved into the leaf last, once the path no longer needs it.
+template <typename Payload>
+template <typename Entry>
+bool RStarTree<Payload>::insert(Node* currentNode, Entry&& entry, const Payload& payload) {
+    if (!currentNode) return false;
+
+    insertPath.clear();
+    for (; !currentNode->isLeaf; currentNode = currentNode->children[insertPath.back().second]) {
+        currentNode->packed = false;
+        if (score) currentNode->maxScore = max(currentNode->maxScore, score(payload));
+        insertPath.emplace_back(currentNode, chooseSubtree(currentNode, entry, false));
+    }
+
+    bool grown = true;
+    for (size_t level = insertPath.size(); grown && level-- > 0;)
+        grown = extend(insertPath[level].first->entries[insertPath[level].second], entry);
+
+    if (score) currentNode->maxScore = max(currentNode->maxScore, score(payload));
+    if constexpr (isHashable<Payload>::value) {
+        if (updateIndexEnabled) leafOf[payload] = currentNode;
+    }
+    currentNode->payloads.push_back(payload);
+    if (pointData) {
+        assert(entry.isPoint() && "point data trees only hold degenerate boxes");
+        currentNode->points.insert(currentNode->points.end(), entry.minCoords.begin(), entry.minCoords.end());
+    } else
+        currentNode->entries.push_back(forward<Entry>(entry));
+
+    for (size_t level = insertPath.size(); level-- > 0;) {
+        Node* parent = insertPath[level].first;
+        size_t index = insertPath[level].second;
+        if (!overflowing(parent->children[index])) break;
+        attachSibling(parent, index, splitOff(parent->children[index]));
+    }
+    return grown;
+}
+
+// Hangs the sibling split off parent->children[index] next to it. Only the two entries are recomputed.
+template <typename Payload>
+void RStarTree<Payload>::attachSibling(Node* parent, size_t index, Node* sibling) {
+    parent->entries[index] = nodeMBR(parent->children[index]);
+    parent->entries.push_back(nodeMBR(sibling));
+    parent->children.push_back(sibling);
+    adopt(parent, sibling);
+}
+
+// Keeps the update index current for a node split off under parent
+template <typename Payload>
+void RStarTree<Payload>::adopt(Node* parent, Node* sibling) {
+    if (!updateIndexEnabled || updateIndexStale) return;
+    sibling->parent = parent;
+    if (sibling->isLeaf) {
+        if constexpr (isHashable<Payload>::value) {
+            for (size_t i = 0; i < leafSize(sibling); ++i)
+                leafOf[sibling->payloads[i]] = sibling;
         }
     } else {
-        Node* bestSubtree = chooseSubtree(currentNode, entry, false);
-        if (bestSubtree) {
-            insert(bestSubtree, entry, allowReinsertion);
-            updateRectangles(currentNode);
-        }
+        for (auto* child : sibling->children)
+            child->parent = sibling;
     }
 }
 
-Node* RStarTree::chooseSubtree(Node* currentNode, const Rectangle& entry, bool isBatch) {
-    Node* bestSubtree = nullptr;
+template <typename Payload>
+size_t RStarTree<Payload>::chooseSubtree(const Node* currentNode, const Rectangle& entry, bool isBatch) {
+    size_t bestSubtree = 0;
     float minAreaIncrease = numeric_limits<float>::max();
     float minArea = numeric_limits<float>::max();
 
-    for (auto* child : currentNode->children) {
-        float areaIncrease = child->entries.front().getAreaIncrease(entry);
-        float area = child->entries.front().getArea();
+    for (size_t i = 0; i < currentNode->children.size(); ++i) {
+        float areaIncrease = currentNode->entries[i].getAreaIncrease(entry);
+        float area = currentNode->entries[i].getArea();
 
         if (areaIncrease < minAreaIncrease || (areaIncrease == minAreaIncrease && area < minArea)) {
             minAreaIncrease = areaIncrease;
             minArea = area;
-            bestSubtree = child;
+            bestSubtree = i;
         }
     }
     return bestSubtree;
 }
 
-void RStarTree::batchInsert(vector<Rectangle>& rectangles) {
+// Grows the MBR to cover the entry and returns whether it changed
+template <typename Payload>
+bool RStarTree<Payload>::extend(Rectangle& mbr, const Rectangle& entry) const {
+    bool changed = false;
+    for (int d = 0; d < dimensions; ++d) {
+        if (entry.minCoords[d] < mbr.minCoords[d]) {
+            mbr.minCoords[d] = entry.minCoords[d];
+            changed = true;
+        }
+        if (entry.maxCoords[d] > mbr.maxCoords[d]) {
+            mbr.maxCoords[d] = entry.maxCoords[d];
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// An entry strictly inside the MBR can be removed without shrinking it
+template <typename Payload>
+bool RStarTree<Payload>::touches(const Rectangle& mbr, const Rectangle& entry) const {
+    for (int d = 0; d < dimensions; ++d) {
+        if (entry.minCoords[d] <= mbr.minCoords[d] || entry.maxCoords[d] >= mbr.maxCoords[d])
+            return true;
+    }
+    return false;
+}
+
+template <typename Payload>
+bool RStarTree<Payload>::overflowing(const Node* node) const {
+    return (node->isLeaf ? leafSize(node) : node->children.size()) > static_cast<size_t>(maxEntries);
+}
+
+template <typename Payload>
+void RStarTree<Payload>::batchInsert(vector<Object<Payload>>& objects) {
+    decompressLeaves();
+    updateIndexStale = true;
 
-    if (root->isLeaf && root->entries.empty()){
-        bulkLoad(rectangles);
+    if (root->isLeaf && leafSize(root) == 0){
+        bulkLoad(objects);
         return;
     }
 
-    sort(rectangles.begin(), rectangles.end(), [](const Rectangle& a, const Rectangle& b) {
+    sort(objects.begin(), objects.end(), [](const Rectangle& a, const Rectangle& b) {
         return a.minCoords[0] < b.minCoords[0];
     });
 
-    int numBatches = (rectangles.size() + maxEntries - 1) / maxEntries;
+    int numBatches = (objects.size() + maxEntries - 1) / maxEntries;
 
     for (int i = 0; i < numBatches; ++i) {
         int startIdx = i * maxEntries;
-        int endIdx = min(static_cast<int>(rectangles.size()), startIdx + maxEntries);
-        vector<Rectangle> batch(rectangles.begin() + startIdx, rectangles.begin() + endIdx);
+        int endIdx = min(static_cast<int>(objects.size()), startIdx + maxEntries);
 
-        Node* newNode = new Node(batch);
+        Node* newNode = new Node(objects.cbegin() + startIdx, objects.cbegin() + endIdx, pointData);
+        refreshMaxScore(newNode);
         root = insertNode(root, newNode);
     }
 }
 
-void RStarTree::recursiveSTRSort(vector<Rectangle>& rects, int dim, int maxDim) {
-    if (dim >= maxDim) return;
+// Write-optimized ingest: entries are appended to an unsorted delta buffer
+// and merged into the tree in bulk (through batchInsert) once it fills up.
+// Queries also scan the buffer, so results stay exact at all times.
+template <typename Payload>
+void RStarTree<Payload>::enableBuffering(size_t capacity) {
+    flushBuffer();
+    bufferCapacity = capacity;
+    buffer.reserve(capacity);
+}
 
-    sort(rects.begin(), rects.end(), [dim](const Rectangle& a, const Rectangle& b) {
-        return a.getCenter()[dim] < b.getCenter()[dim];
-    });
+template <typename Payload>
+void RStarTree<Payload>::bufferedInsert(const Object<Payload>& object) {
+    if (bufferCapacity == 0) {
+        insert(object);
+        return;
+    }
+
+    buffer.push_back(object);
+    if (buffer.size() >= bufferCapacity)
+        flushBuffer();
+}
 
-    size_t sliceSize = (rects.size() + maxEntries - 1) / maxEntries;
+template <typename Payload>
+void RStarTree<Payload>::flushBuffer() {
+    if (buffer.empty()) return;
 
-    for (size_t start = 0; start < rects.size(); start += sliceSize) {
-        size_t end = min(start + sliceSize, rects.size());
-        vector<Rectangle> subRects(rects.begin() + start, rects.begin() + end);
-        recursiveSTRSort(subRects, dim + 1, maxDim);
-    }
+    batchInsert(buffer);
+    buffer.clear();
 }
 
-void RStarTree::bulkLoad(vector<Rectangle>& rectangles) {
-    recursiveSTRSort(rectangles, 0, dimensions);
+template <typename Payload>
+void RStarTree<Payload>::bulkLoad(vector<Object<Payload>>& objects) {
+    vector<Node*> leaves = packObjects(objects);
+    packLevels(leaves);
+}
+
+template <typename Payload>
+vector<typename RStarTree<Payload>::Node*> RStarTree<Payload>::packObjects(const vector<Object<Payload>>& objects) {
+    return packSTR(objects.size(),
+        [&objects](size_t i, int dim) {
+            return (objects[i].minCoords[dim] + objects[i].maxCoords[dim]) / 2.0F;
+        },
+        [this, &objects](Node* leaf, size_t i) {
+            if (pointData) {
+                assert(objects[i].isPoint() && "point data trees only hold degenerate boxes");
+                leaf->points.insert(leaf->points.end(), objects[i].minCoords.begin(), objects[i].minCoords.end());
+            } else
+                leaf->entries.push_back(objects[i]);
+            leaf->payloads.push_back(objects[i].payload);
+        });
+}
 
-    vector<Node*> newNodes;
-    size_t sliceSize = (rectangles.size() + maxEntries - 1) / maxEntries;
+// Bulk loads points straight from coordinate buffers, without building an Object per point.
+// Coordinate d of point i is columns[d][i * stride]: columnar arrays (x[], y[], ...) use
+// stride 1, while an interleaved buffer (x, y, x, y, ...) uses {data, data + 1} and stride 2.
+template <typename Payload>
+void RStarTree<Payload>::bulkLoad(const vector<const float*>& columns, const Payload* payloads, size_t count, size_t stride) {
+    vector<Node*> leaves = packSTR(count,
+        [&columns, stride](size_t i, int dim) {
+            return columns[dim][i * stride];
+        },
+        [this, &columns, payloads, stride](Node* leaf, size_t i) {
+            if (pointData) {
+                for (int d = 0; d < dimensions; ++d)
+                    leaf->points.push_back(columns[d][i * stride]);
+            } else {
+                vector<float> point(dimensions);
+                for (int d = 0; d < dimensions; ++d)
+                    point[d] = columns[d][i * stride];
+                leaf->entries.emplace_back(point, point);
+            }
+            leaf->payloads.push_back(payloads[i]);
+        });
+    packLevels(leaves);
+}
 
-    for (size_t start = 0; start < rectangles.size(); start += sliceSize) {
-        size_t end = min(start + sliceSize, rectangles.size());
-        Node* newNode = new Node(vector<Rectangle>(rectangles.begin() + start, rectangles.begin() + end));
-        newNodes.push_back(newNode);
+// STR packing over an index permutation: only indices move while sorting, and fill
+// writes item i straight into its leaf. Returns the leaves in STR order.
+template <typename Payload>
+template <typename Center, typename Fill>
+vector<typename RStarTree<Payload>::Node*> RStarTree<Payload>::packSTR(size_t count, const Center& center, const Fill& fill) {
+    vector<Node*> leaves;
+    if (count == 0) return leaves;
+
+    vector<size_t> perm(count);
+    iota(perm.begin(), perm.end(), 0);
+    strSort(perm, 0, count, 0, center);
+
+    leaves.reserve((count + maxEntries - 1) / maxEntries);
+
+    for (size_t start = 0; start < count; start += maxEntries) {
+        size_t end = min(start + maxEntries, count);
+        Node* leaf = new Node(true);
+        if (pointData) 
+            leaf->points.reserve((end - start) * dimensions);
+        else
+            leaf->entries.reserve(end - start);
+
+        for (size_t i = start; i < end; ++i)
+            fill(leaf, perm[i]);
+        refreshMaxScore(leaf);
+        leaves.push_back(leaf);
     }
+    return leaves;
+}
 
-    if (newNodes.size() == 1) {
-        delete root;
-        root = newNodes.front();
-    } else {
-        Node* newRoot = new Node(false);
-        for (auto* node : newNodes) 
-            newRoot->children.push_back(node);
-        delete root;
-        root = newRoot;
+// Sorts perm[first, last) into STR order: slabs along dim, each tiled recursively on the next dimension
+template <typename Payload>
+template <typename Center>
+void RStarTree<Payload>::strSort(vector<size_t>& perm, size_t first, size_t last, int dim, const Center& center) const {
+    sort(perm.begin() + first, perm.begin() + last, [&center, dim](size_t a, size_t b) {
+        return center(a, dim) < center(b, dim);
+    });
+    // A range that fits one node (or is empty) needs no slabs
+    if (dim + 1 >= dimensions || last - first <= static_cast<size_t>(maxEntries)) return;
+
+    size_t nodeCount = (last - first + maxEntries - 1) / maxEntries;
+    size_t slabCount = static_cast<size_t>(ceil(pow(static_cast<double>(nodeCount), 1.0 / (dimensions - dim))));
+    size_t slabSize = ((nodeCount + slabCount - 1) / slabCount) * maxEntries;
+
+    for (size_t start = first; start < last; start += slabSize)
+        strSort(perm, start, min(start + slabSize, last), dim + 1, center);
+}
+
+// Packs STR-ordered nodes into parents, level by level, until a single root remains
+template <typename Payload>
+void RStarTree<Payload>::packLevels(vector<Node*>& nodes) {
+    while (nodes.size() > 1)
+        nodes = packParents(nodes);
+    updateIndexStale = true;
+    leavesCompressed = false;
+    decodedFrom = nullptr;
+
+    delete root;
+    root = nodes.empty() ? new Node(true) : nodes.front();
+}
+
+// Packs one level: groups STR-ordered nodes into full parents
+template <typename Payload>
+vector<typename RStarTree<Payload>::Node*> RStarTree<Payload>::packParents(const vector<Node*>& nodes) const {
+    vector<Rectangle> mbrs;
+    mbrs.reserve(nodes.size());
+    for (auto* node : nodes)
+        mbrs.push_back(nodeMBR(node));
+
+    vector<size_t> perm(nodes.size());
+    iota(perm.begin(), perm.end(), 0);
+    strSort(perm, 0, perm.size(), 0, [&mbrs](size_t i, int dim) {
+        return (mbrs[i].minCoords[dim] + mbrs[i].maxCoords[dim]) / 2.0F;
+    });
+
+    vector<Node*> parents;
+    for (size_t start = 0; start < perm.size(); start += maxEntries) {
+        Node* parent = new Node(false);
+        parent->packed = true;
+        for (size_t i = start; i < min(start + maxEntries, perm.size()); ++i) {
+            parent->children.push_back(nodes[perm[i]]);
+            parent->entries.push_back(move(mbrs[perm[i]]));
+        }
+        refreshMaxScore(parent);
+        parents.push_back(parent);
     }
-    updateRectangles(root);
+    return parents;
 }
 
-void RStarTree::updateRectangles(Node* node) {
-    if (!node || node->isLeaf) return;
+// Re-packs the worst-shaped subtrees with STR, worst first, until budget objects have been
+// moved. Subtrees keep their height and MBR, so the rest of the tree is left untouched.
+// Only subtrees scoring above minScore and changed since they were last packed are
+// considered, so repeated calls converge. Returns the number of objects moved.
+template <typename Payload>
+size_t RStarTree<Payload>::optimize(size_t budget, double minScore) {
+    decompressLeaves();
+    struct Candidate {
+        Node* node;
+        int height;
+        size_t objects;
+        double score;
+        size_t first, last; // Preorder range of the subtree, to keep picks disjoint
+    };
+    vector<Candidate> candidates;
+
+    function<pair<int, size_t>(Node*)> collect = [&](Node* node) -> pair<int, size_t> {
+        if (node->isLeaf) return {0, leafSize(node)};
+
+        size_t index = candidates.size();
+        candidates.push_back({node, 0, 0, repackScore(node), index, 0});
+        int height = 0;
+        size_t objects = 0;
+        for (auto* child : node->children) {
+            auto below = collect(child);
+            height = below.first + 1;
+            objects += below.second;
+        }
+        candidates[index].height = height;
+        candidates[index].objects = objects;
+        candidates[index].last = candidates.size();
+        return {height, objects};
+    };
+    if (!root) return 0;
+    collect(root);
+
+    sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.score > b.score;
+    });
 
-    // Clear existing entries before updating
-    node->entries.clear();
-    
-    // Ensure children vector is not empty
-    if (node->children.empty()) return;
-    
-    // Update entries based on children
-    for (auto* child : node->children) {
-        if (child && !child->entries.empty()) 
-            node->entries.push_back(Rectangle::combine(child->entries));
+    size_t moved = 0;
+    vector<const Candidate*> picked;
+    for (const auto& candidate : candidates) {
+        if (candidate.score <= minScore) break;
+        if (candidate.node->packed || moved + candidate.objects > budget) continue;
+
+        bool disjoint = true;
+        for (const auto* other : picked)
+            disjoint = disjoint && (candidate.last <= other->first || other->last <= candidate.first);
+        if (!disjoint) continue;
+
+        picked.push_back(&candidate);
+        moved += candidate.objects;
     }
+
+    // Nested picks are excluded, so repacking one cannot free another
+    for (const auto* candidate : picked)
+        repack(candidate->node, candidate->height);
+    return moved;
 }
 
-void RStarTree::reinsert(Node* node) {
-    if (!node || node->isLeaf) return;
+// Rebuilds the subtree below node with STR at the same height, in place
+template <typename Payload>
+void RStarTree<Payload>::repack(Node* node, int height) {
+    updateIndexStale = true;
+    vector<Object<Payload>> objects;
+    forEachObject(node, [&objects](const Rectangle& box, const Payload& payload) {
+        objects.emplace_back(box, payload);
+    });
+    for (auto* child : node->children)
+        delete child;
+
+    vector<Node*> nodes = packObjects(objects);
+    for (int level = 1; level < height; ++level)
+        nodes = packParents(nodes);
 
-    vector<Rectangle> entriesToReinsert;
-    vector<Node*> childrenToReinsert;
+    node->children = nodes;
+    node->packed = true;
+    node->entries.clear();
+    for (auto* child : nodes)
+        node->entries.push_back(nodeMBR(child));
+    refreshMaxScore(node);
+}
+
+// Fraction of the node's MBR that is covered twice by its children or not at all
+template <typename Payload>
+double RStarTree<Payload>::repackScore(const Node* node) const {
+    Rectangle mbr = nodeMBR(node);
+    double area = mbr.getArea();
+    if (area <= 0.0) return 0.0;
+
+    double overlap = 0.0;
+    for (size_t i = 0; i < node->entries.size(); ++i)
+        for (size_t j = i + 1; j < node->entries.size(); ++j)
+            overlap += node->entries[i].getOverlapArea(node->entries[j]);
+    return overlap / area;
+}
 
-    // Identify entries to reinsert (typically 30% of entries)
-    size_t reinsertCount = node->entries.size() / 3;
-    if (reinsertCount == 0) return;
+template <typename Payload>
+size_t RStarTree<Payload>::leafSize(const Node* node) const {
+    if (!node->compressed.empty()) {
+        uint32_t count;
+        memcpy(&count, node->compressed.data(), sizeof(count));
+        return count;
+    }
+    if (pointData && node->isLeaf)
+        return node->points.size() / dimensions;
+    return node->entries.size();
+}
 
-    // Take the last reinsertCount entries for reinsertion
-    for (size_t i = 0; i < reinsertCount; i++) {
-        size_t idx = node->entries.size() - 1;
-        entriesToReinsert.push_back(node->entries[idx]);
-        if (!node->isLeaf) 
-            childrenToReinsert.push_back(node->children[idx]);
-        node->entries.pop_back();
-        if (!node->isLeaf) 
-            node->children.pop_back();
+template <typename Payload>
+Rectangle RStarTree<Payload>::nodeMBR(const Node* node) const {
+    if (node->isLeaf) node = leafView(node);
+    // An empty node (the root of an empty tree) gets the empty box, as in point mode
+    if (!pointData || !node->isLeaf)
+        return node->entries.empty() ? Rectangle(dimensions) : Rectangle::combine(node->entries);
+
+    Rectangle mbr(dimensions);
+    for (size_t i = 0; i < node->points.size(); i += dimensions) {
+        for (int d = 0; d < dimensions; ++d) {
+            mbr.minCoords[d] = min(mbr.minCoords[d], node->points[i + d]);
+            mbr.maxCoords[d] = max(mbr.maxCoords[d], node->points[i + d]);
+        }
     }
+    return mbr;
+}
 
-    // Update MBR after removing entries
-    updateRectangles(node);
+template <typename Payload>
+bool RStarTree<Payload>::pointInBox(const float* point, const Rectangle& box) const {
+    for (int d = 0; d < dimensions; ++d) {
+        if (point[d] < box.minCoords[d] || point[d] > box.maxCoords[d])
+            return false;
+    }
+    return true;
+}
 
-    // Reinsert entries
-    for (size_t i = 0; i < entriesToReinsert.size(); i++) {
-        if (node->isLeaf) {
-            // For leaf nodes, just reinsert the entry
-            insert(root, entriesToReinsert[i], false);
-        }
-        else {
-            // For internal nodes, find the best subtree for each child
-            Node* child = childrenToReinsert[i];
-            const Rectangle& mbr = entriesToReinsert[i];
-            
-            // Find the best node to insert this child into
-            Node* bestNode = chooseSubtree(root, mbr, true);
-            
-            // Add the child to the best node
-            bestNode->entries.push_back(mbr);
-            bestNode->children.push_back(child);
-            
-            // Update MBR of the best node
-            updateRectangles(bestNode);
-            
-            // Check if the best node needs to be split
-            if (bestNode->entries.size() > maxEntries) {
-                // We know the parent of bestNode is root in this context
-                Node* newNode = splitNode(bestNode);
-                
-                // If the root was split, update it
-                if (bestNode == root) 
-                    root = newNode;
-            }
-        }
-    }
-}
-
-Node* RStarTree::insertNode(Node* currentNode, Node* newNode) {
+template <typename Payload>
+BasicNode<Payload>* RStarTree<Payload>::insertNode(Node* currentNode, Node* newNode) {
     if (!currentNode)
         // Current node is null, returning new node
         return newNode;
@@ -374,74 +1127,108 @@ Node* RStarTree::insertNode(Node* currentNode, Node* newNode) {
         Node* newInternalNode = new Node(false);
         newInternalNode->children.push_back(currentNode);
         newInternalNode->children.push_back(newNode);
-        newInternalNode->entries.push_back(Rectangle::combine(currentNode->entries));
-        newInternalNode->entries.push_back(Rectangle::combine(newNode->entries));
+        newInternalNode->entries.push_back(nodeMBR(currentNode));
+        newInternalNode->entries.push_back(nodeMBR(newNode));
+        refreshMaxScore(newInternalNode);
         return newInternalNode;
     }
     
     // Current node is not a leaf, finding best subtree
-    Node* bestNode = chooseSubtree(currentNode, Rectangle::combine(newNode->entries), true);
+    currentNode->packed = false;
+    Rectangle mbr = nodeMBR(newNode);
+    size_t best = chooseSubtree(currentNode, mbr, true);
+    Node* bestNode = currentNode->children[best];
     
     if (bestNode->isLeaf) {
         // Best node is a leaf, adding new node as child
-        currentNode->entries.push_back(Rectangle::combine(newNode->entries));
+        currentNode->entries.push_back(mbr);
         currentNode->children.push_back(newNode);
     } else {
-        // Recursively inserting into best node
-        Node* result = insertNode(bestNode, newNode);
-        
-        if (result != bestNode) {
-            // Best node was replaced, updating reference
-            for (size_t i = 0; i < currentNode->children.size(); i++) {
-                if (currentNode->children[i] == bestNode) {
-                    currentNode->children[i] = result;
-                    break;
-                }
-            }
-        }
+        // Recursively inserting into best node, then growing only its entry
+        insertNode(bestNode, newNode);
+        extend(currentNode->entries[best], mbr);
+
+        // Overflowing children are split here, where the sibling has a parent to go to
+        if (overflowing(bestNode))
+            attachSibling(currentNode, best, splitOff(bestNode));
     }
-    
-    // Ensure entries and children are synchronized
-    updateRectangles(currentNode);
+    if (score) currentNode->maxScore = max(currentNode->maxScore, newNode->maxScore);
 
     // Ensure entries and children sizes are consistent
     if (currentNode->children.size() != currentNode->entries.size()) 
         cerr << "Error: Mismatch between entries and children sizes." << endl;
     
-    if (currentNode->entries.size() > maxEntries) {
-        // Current node exceeds max entries, splitting node
-        Node* splitResult = splitNode(currentNode);
-        return splitResult; // Return the result directly, it will be either the original node or a new root
+    if (currentNode == root && overflowing(currentNode)) {
+        // Root exceeds max entries, splitting it into a new root
+        return splitNode(currentNode);
     }
     return currentNode;
 }
 
-void RStarTree::chooseBestSplit(const vector<Rectangle>& sortedEntries, vector<size_t>& sortedIndices, size_t& bestAxis, size_t& bestSplitIndex) const {
+// Coordinate d of entry i of a node being split (upper: max corner). Point leaves keep one tuple per entry inline.
+template <typename Payload>
+float RStarTree<Payload>::splitCoord(const Node* node, size_t i, int d, bool upper) const {
+    if (pointData && node->isLeaf) return node->points[i * dimensions + d];
+    return upper ? node->entries[i].maxCoords[d] : node->entries[i].minCoords[d];
+}
+
+// Orders the entries by their lower coordinate along the axis, into splitOrder
+template <typename Payload>
+void RStarTree<Payload>::sortSplitOrder(const Node* node, int axis) const {
+    splitOrder.resize(node->isLeaf ? leafSize(node) : node->children.size());
+    iota(splitOrder.begin(), splitOrder.end(), 0);
+    sort(splitOrder.begin(), splitOrder.end(), [&](size_t a, size_t b) {
+        return splitCoord(node, a, axis, false) < splitCoord(node, b, axis, false);
+    });
+}
 
+// Picks the axis and split index with the least overlap (then area) between the two halves.
+// The MBRs of every prefix and suffix of the sorted entries are built once per axis in
+// splitBounds, as {min corner, max corner} tuples, so each candidate split costs O(D).
+template <typename Payload>
+void RStarTree<Payload>::chooseBestSplit(const Node* node, size_t& bestAxis, size_t& bestSplitIndex) const {
     float minOverlap = numeric_limits<float>::max();
     float minArea = numeric_limits<float>::max();
+    size_t count = node->isLeaf ? leafSize(node) : node->children.size();
+    size_t width = 2 * dimensions;
+    splitBounds.resize(2 * count * width);
+    float* prefix = splitBounds.data();
+    float* suffix = prefix + count * width;
 
     for (int axis = 0; axis < dimensions; ++axis) {
-        // Sort entries by minCoords along the current axis and track indices
-        sort(sortedIndices.begin(), sortedIndices.end(),
-             [&sortedEntries, axis](size_t i, size_t j) {
-                 return sortedEntries[i].minCoords[axis] < sortedEntries[j].minCoords[axis];
-             });
-
-        vector<Rectangle> sortedByAxis(sortedEntries.size());
-        for (size_t i = 0; i < sortedIndices.size(); ++i) 
-            sortedByAxis[i] = sortedEntries[sortedIndices[i]];
+        sortSplitOrder(node, axis);
+        for (size_t k = 0; k < count; ++k) {
+            float* box = prefix + k * width;
+            for (int d = 0; d < dimensions; ++d) {
+                box[d] = splitCoord(node, splitOrder[k], d, false);
+                box[dimensions + d] = splitCoord(node, splitOrder[k], d, true);
+                if (k == 0) continue;
+                box[d] = min(box[d], box[d - width]);
+                box[dimensions + d] = max(box[dimensions + d], box[dimensions + d - width]);
+            }
+        }
+        for (size_t k = count; k-- > 0;) {
+            float* box = suffix + k * width;
+            for (int d = 0; d < dimensions; ++d) {
+                box[d] = splitCoord(node, splitOrder[k], d, false);
+                box[dimensions + d] = splitCoord(node, splitOrder[k], d, true);
+                if (k + 1 == count) continue;
+                box[d] = min(box[d], box[d + width]);
+                box[dimensions + d] = max(box[dimensions + d], box[dimensions + d + width]);
+            }
+        }
 
         // Evaluate split points for the current axis
-        for (size_t splitIndex = minEntries; splitIndex <= sortedEntries.size() - minEntries; ++splitIndex) {
-            vector<Rectangle> leftEntries(sortedByAxis.begin(), sortedByAxis.begin() + splitIndex);
-            vector<Rectangle> rightEntries(sortedByAxis.begin() + splitIndex, sortedByAxis.end());
-
-            Rectangle leftBoundingRect = Rectangle::combine(leftEntries);
-            Rectangle rightBoundingRect = Rectangle::combine(rightEntries);
-
-            float overlap = leftBoundingRect.getOverlapArea(rightBoundingRect);
-            float area = leftBoundingRect.getArea() + rightBoundingRect.getArea();
+        for (size_t splitIndex = max(minEntries, 1); splitIndex + minEntries <= count; ++splitIndex) {
+            const float* left = prefix + (splitIndex - 1) * width;
+            const float* right = suffix + splitIndex * width;
+            float overlap = 1.0F, leftArea = 1.0F, rightArea = 1.0F;
+            for (int d = 0; d < dimensions; ++d) {
+                overlap *= max(0.0F, min(left[dimensions + d], right[dimensions + d]) - max(left[d], right[d]));
+                leftArea *= left[dimensions + d] - left[d];
+                rightArea *= right[dimensions + d] - right[d];
+            }
+            float area = leftArea + rightArea;
 
             if (overlap < minOverlap || (overlap == minOverlap && area < minArea)) {
                 bestAxis = axis;
@@ -453,74 +1240,87 @@ void RStarTree::chooseBestSplit(const vector<Rectangle>& sortedEntries, vector<s
     }
 }
 
-void RStarTree::sortEntriesAndChildren(Node* node, const vector<Rectangle>& sortedEntries, vector<size_t>& sortedIndices, size_t bestAxis) {
-    if (!node || node->children.empty()) return;
-
-    // Sort indices based on the best axis
-    sort(sortedIndices.begin(), sortedIndices.end(), [&](size_t a, size_t b) {
-        return sortedEntries[a].getCenter()[bestAxis] < sortedEntries[b].getCenter()[bestAxis];
-    });
+// Permutes the entries with their children (or payloads) in place, following the cycles of
+// splitOrder, so they stay aligned without copying the node
+template <typename Payload>
+void RStarTree<Payload>::sortEntriesAndChildren(Node* node, size_t bestAxis) const {
+    sortSplitOrder(node, bestAxis);
+    bool points = pointData && node->isLeaf;
+    auto swapEntries = [&](size_t a, size_t b) {
+        if (points)
+            swap_ranges(node->points.begin() + a * dimensions, node->points.begin() + (a + 1) * dimensions, node->points.begin() + b * dimensions);
+        else
+            swap(node->entries[a], node->entries[b]);
+        if (node->isLeaf)
+            node->payloads.swapAt(a, b);
+        else
+            swap(node->children[a], node->children[b]);
+    };
 
-    // Create a copy of the children before modifying them
-    vector<Node*> oldChildren = node->children;
-    vector<Node*> sortedChildren;
-    
-    // Only process indices that are within the bounds of oldChildren
-    for (size_t i = 0; i < sortedIndices.size() && i < oldChildren.size(); ++i) {
-        size_t index = sortedIndices[i];
-        if (index < oldChildren.size()) 
-            sortedChildren.push_back(oldChildren[index]);
+    for (size_t i = 0; i < splitOrder.size(); ++i) {
+        for (size_t j = i; splitOrder[j] != j;) {
+            size_t k = splitOrder[j];
+            splitOrder[j] = j;
+            if (k == i) break;
+            swapEntries(j, k);
+            j = k;
+        }
     }
-    
-    // Only update if we have a valid result
-    if (!sortedChildren.empty())
-        node->children = sortedChildren;
 }
 
-Node* RStarTree::splitNode(Node* node) const {
-    if (!node || node->entries.empty()) {
-        cerr << "Error: Invalid node in splitNode!" << endl;
-        return node;
-    }
-
+template <typename Payload>
+BasicNode<Payload>* RStarTree<Payload>::splitOff(Node* node) const {
     // Choose split axis and index
-    size_t bestAxis = -1,  bestSplitIndex = -1;
-    vector<size_t> sortedIndices(node->entries.size());
-    iota(sortedIndices.begin(), sortedIndices.end(), 0); // Fill with 0, 1, ..., totalEntries-1
-
-    chooseBestSplit(node->entries, sortedIndices, bestAxis, bestSplitIndex);
-
-    sortEntriesAndChildren(node, node->entries, sortedIndices, bestAxis);
-
-    // Split
-    vector<Rectangle> leftEntries(node->entries.begin(), node->entries.begin() + bestSplitIndex);
-    vector<Rectangle> rightEntries(node->entries.begin() + bestSplitIndex, node->entries.end());
+    size_t bestAxis = 0, bestSplitIndex = 0;
+    size_t count = node->isLeaf ? leafSize(node) : node->children.size();
+    chooseBestSplit(node, bestAxis, bestSplitIndex);
+    sortEntriesAndChildren(node, bestAxis);
 
+    // Move the right part into a new sibling, with room to fill up to its own split
     Node* newNode = new Node(node->isLeaf);
+    if (pointData && node->isLeaf) {
+        newNode->points.reserve((maxEntries + 1) * dimensions);
+        newNode->points.assign(node->points.begin() + bestSplitIndex * dimensions, node->points.end());
+        node->points.resize(bestSplitIndex * dimensions);
+    } else {
+        newNode->entries.reserve(maxEntries + 1);
+        newNode->entries.assign(make_move_iterator(node->entries.begin() + bestSplitIndex), make_move_iterator(node->entries.end()));
+        node->entries.resize(bestSplitIndex);
+    }
 
-    if (!node->isLeaf) {
-        vector<Node*> leftChildren, rightChildren;
-        for (size_t i = 0; i < node->entries.size(); ++i) {
-            if (i < bestSplitIndex) 
-                leftChildren.push_back(node->children[i]);
-            else 
-                rightChildren.push_back(node->children[i]);
-        }
+    if (node->isLeaf) {
+        newNode->payloads.reserve(maxEntries + 1);
+        for (size_t i = bestSplitIndex; i < count; ++i)
+            newNode->payloads.push_back(move(node->payloads[i]));
+        node->payloads.resize(bestSplitIndex);
+    } else {
+        newNode->children.reserve(maxEntries + 1);
+        newNode->children.assign(node->children.begin() + bestSplitIndex, node->children.end());
+        node->children.resize(bestSplitIndex);
+    }
+
+    refreshMaxScore(node);
+    refreshMaxScore(newNode);
+    return newNode;
+}
 
-        node->children = leftChildren;
-        newNode->children = rightChildren;
+template <typename Payload>
+BasicNode<Payload>* RStarTree<Payload>::splitNode(Node* node) const {
+    if (!node || leafSize(node) == 0) {
+        cerr << "Error: Invalid node in splitNode!" << endl;
+        return node;
     }
 
-    node->entries = leftEntries;
-    newNode->entries = rightEntries;
+    Node* newNode = splitOff(node);
 
     // If this is the root node being split, create a new root
     if (node == root) {
         Node* newRoot = new Node(false);
         newRoot->children.push_back(node);
         newRoot->children.push_back(newNode);
-        newRoot->entries.push_back(Rectangle::combine(node->entries));
-        newRoot->entries.push_back(Rectangle::combine(newNode->entries));
+        newRoot->entries.push_back(nodeMBR(node));
+        newRoot->entries.push_back(nodeMBR(newNode));
+        refreshMaxScore(newRoot);
         return newRoot; // Return the new root to update the tree's root
     }
     
@@ -529,20 +1329,599 @@ Node* RStarTree::splitNode(Node* node) const {
     return node;
 }
 
-vector<Rectangle> RStarTree::rangeQuery(const Rectangle& query){
-    vector<Rectangle> results;
-    if (root) rangeQuery(root, query, results);
-    return results;
+// Deletes one object matching both the rectangle and the payload. Leaves left with fewer
+// than minEntries objects are dissolved and their objects reinserted (condense tree).
+template <typename Payload>
+bool RStarTree<Payload>::remove(const Object<Payload>& object) {
+    decompressLeaves();
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        if (buffer[i] == object && buffer[i].payload == object.payload) {
+            buffer[i] = buffer.back();
+            buffer.pop_back();
+            return true;
+        }
+    }
+
+    vector<Object<Payload>> orphans;
+    if (!root || !remove(root, object, object.payload, orphans)) return false;
+    if constexpr (isHashable<Payload>::value) {
+        if (updateIndexEnabled) leafOf.erase(object.payload);
+    }
+    Node* oldRoot = root;
+
+    // Shorten the tree while the root has a single child
+    while (!root->isLeaf && root->children.size() == 1) {
+        Node* child = root->children.front();
+        root->children.clear();
+        delete root;
+        root = child;
+    }
+    if (!root->isLeaf && root->children.empty()) {
+        delete root;
+        root = new Node(true);
+    }
+    // Reinserting the orphans points the update index at their new leaves
+    if (root != oldRoot) root->parent = nullptr;
+
+    for (const auto& orphan : orphans)
+        insert(orphan);
+    return true;
 }
 
-void RStarTree::rangeQuery(Node* node, const Rectangle& query, vector<Rectangle>& results) {
-    if (!node) return;
+template <typename Payload>
+bool RStarTree<Payload>::remove(Node* node, const Rectangle& entry, const Payload& payload, vector<Object<Payload>>& orphans) {
+    if (node->isLeaf) {
+        for (size_t i = 0; i < leafSize(node); ++i) {
+            if (leafEntryEquals(node, i, entry) && node->payloads[i] == payload) {
+                removeLeafEntry(node, i);
+                refreshMaxScore(node);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for (size_t i = 0; i < node->children.size(); ++i) {
+        if (!node->entries[i].overlapCheck(entry) || !remove(node->children[i], entry, payload, orphans))
+            continue;
+
+        node->packed = false;
+        Node* child = node->children[i];
+        if (leafSize(child) < static_cast<size_t>(minEntries)) {
+            // Underfull child: detach it and keep its objects for reinsertion
+            forEachObject(child, [&orphans](const Rectangle& box, const Payload& p) {
+                orphans.emplace_back(box, p);
+            });
+            delete child;
+            node->children.erase(node->children.begin() + i);
+            node->entries.erase(node->entries.begin() + i);
+        } else if (touches(node->entries[i], entry)) {
+            // Only an entry on the boundary can shrink the child's MBR
+            node->entries[i] = nodeMBR(child);
+        }
+        refreshMaxScore(node);
+        return true;
+    }
+    return false;
+}
+
+template <typename Payload>
+bool RStarTree<Payload>::leafEntryEquals(const Node* leaf, size_t index, const Rectangle& entry) const {
+    if (!pointData)
+        return leaf->entries[index] == entry;
+
+    for (int d = 0; d < dimensions; ++d) {
+        float coord = leaf->points[index * dimensions + d];
+        if (coord != entry.minCoords[d] || coord != entry.maxCoords[d])
+            return false;
+    }
+    return true;
+}
+
+// Order inside a leaf does not matter, so the last entry fills the gap
+template <typename Payload>
+void RStarTree<Payload>::removeLeafEntry(Node* leaf, size_t index) const {
+    size_t last = leafSize(leaf) - 1;
+    if (pointData) {
+        copy(leaf->points.begin() + last * dimensions, leaf->points.end(), leaf->points.begin() + index * dimensions);
+        leaf->points.resize(last * dimensions);
+    } else {
+        leaf->entries[index] = leaf->entries[last];
+        leaf->entries.pop_back();
+    }
+    leaf->payloads[index] = leaf->payloads[last];
+    leaf->payloads.pop_back();
+}
+
+// Deletes every object intersecting the box (and accepted by filter(box, payload), if given)
+// in one pass. Without a filter, subtrees lying fully inside the box are freed without being
+// visited; partially covered leaves are filtered in place. Nodes left underfull are dissolved
+// and their objects merged back once at the end. Returns the number of objects removed.
+template <typename Payload>
+size_t RStarTree<Payload>::removeRange(const Rectangle& box) {
+    auto all = [](const Rectangle&, const Payload&) { return true; };
+    return removeRange(box, all, false);
+}
+
+template <typename Payload>
+template <typename Filter>
+size_t RStarTree<Payload>::removeRange(const Rectangle& box, Filter filter) {
+    return removeRange(box, filter, true);
+}
+
+template <typename Payload>
+template <typename Filter>
+size_t RStarTree<Payload>::removeRange(const Rectangle& box, Filter& filter, bool filtered) {
+    decompressLeaves();
+    size_t before = buffer.size();
+    buffer.erase(remove_if(buffer.begin(), buffer.end(), [&](const Object<Payload>& object) {
+        return box.overlapCheck(object) && filter(object, object.payload);
+    }), buffer.end());
+    size_t removed = before - buffer.size();
+
+    vector<Object<Payload>> orphans;
+    if (!root) return removed;
+    size_t removedFromTree = removeRange(root, box, filter, filtered, orphans);
+    if (removedFromTree == 0) return removed;
+    updateIndexStale = true;
+
+    // Shorten the tree while the root has a single child
+    while (!root->isLeaf && root->children.size() == 1) {
+        Node* child = root->children.front();
+        root->children.clear();
+        delete root;
+        root = child;
+    }
+    if (!root->isLeaf && root->children.empty()) {
+        delete root;
+        root = new Node(true);
+    }
+
+    if (orphans.size() < static_cast<size_t>(maxEntries)) {
+        for (const auto& orphan : orphans)
+            insert(orphan);
+    } else {
+        batchInsert(orphans);
+    }
+    return removed + removedFromTree;
+}
+
+template <typename Payload>
+template <typename Filter>
+size_t RStarTree<Payload>::removeRange(Node* node, const Rectangle& box, Filter& filter, bool filtered, vector<Object<Payload>>& orphans) {
+    size_t removed = 0;
+    if (node->isLeaf) {
+        // Removal moves the last entry into the gap, so walk backwards over checked entries
+        for (size_t i = leafSize(node); i-- > 0;) {
+            bool inside = pointData ? pointInBox(&node->points[i * dimensions], box) : box.overlapCheck(node->entries[i]);
+            if (inside && (!filtered || filter(leafObject(node, i), node->payloads[i]))) {
+                removeLeafEntry(node, i);
+                ++removed;
+            }
+        }
+        if (removed) refreshMaxScore(node);
+        return removed;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < node->children.size(); ++i) {
+        Node* child = node->children[i];
+        const Rectangle& entry = node->entries[i];
+        size_t removedBelow = 0;
+
+        if (!filtered && box.contains(entry)) {
+            // Fully covered: everything below goes, without visiting the objects
+            vector<const Node*> stack = {child};
+            while (!stack.empty()) {
+                const Node* below = stack.back();
+                stack.pop_back();
+                if (below->isLeaf) removedBelow += leafSize(below);
+                stack.insert(stack.end(), below->children.begin(), below->children.end());
+            }
+            delete child;
+            removed += removedBelow;
+            continue;
+        }
+        if (box.overlapCheck(entry))
+            removedBelow = removeRange(child, box, filter, filtered, orphans);
+        removed += removedBelow;
+
+        if (removedBelow > 0) {
+            size_t size = child->isLeaf ? leafSize(child) : child->children.size();
+            if (size < static_cast<size_t>(minEntries)) {
+                // Underfull: keep its objects for the merge at the end
+                forEachObject(child, [&orphans](const Rectangle& object, const Payload& payload) {
+                    orphans.emplace_back(object, payload);
+                });
+                delete child;
+                continue;
+            }
+        }
+        node->children[kept] = child;
+        node->entries[kept] = removedBelow > 0 ? nodeMBR(child) : entry;
+        ++kept;
+    }
+    node->children.resize(kept);
+    node->entries.resize(kept);
+    if (removed) {
+        node->packed = false;
+        refreshMaxScore(node);
+    }
+    return removed;
+}
+
+// Moving objects: update() relocates an object bottom-up instead of deleting and
+// reinserting it from the root. The index maps each id to its leaf and sets parent
+// pointers; it assumes unique ids and is rebuilt lazily after structural changes
+// (splits, batch inserts, bulk loads, repacking, condensing removes).
+// A leaf's entry may grow by up to slack to absorb small moves in place.
+template <typename Payload>
+void RStarTree<Payload>::enableUpdates(float slack) {
+    if constexpr (!isHashable<Payload>::value) {
+        cerr << "Error: The update index needs a std::hash for the payload type" << endl;
+        return;
+    }
+    updateIndexEnabled = true;
+    updateSlack = slack;
+    rebuildUpdateIndex();
+}
+
+template <typename Payload>
+void RStarTree<Payload>::rebuildUpdateIndex() {
+    decompressLeaves();
+    leafOf.clear();
+    updateIndexStale = false;
+    if (!root) return;
+
+    root->parent = nullptr;
+    vector<Node*> stack = {root};
+    while (!stack.empty()) {
+        Node* node = stack.back();
+        stack.pop_back();
+
+        if (node->isLeaf) {
+            if constexpr (isHashable<Payload>::value) {
+                for (size_t i = 0; i < leafSize(node); ++i)
+                    leafOf[node->payloads[i]] = node;
+            }
+            continue;
+        }
+        for (auto* child : node->children) {
+            child->parent = node;
+            stack.push_back(child);
+        }
+    }
+}
+
+template <typename Payload>
+bool RStarTree<Payload>::update(const Payload& id, const Rectangle& oldBox, const Rectangle& newBox) {
+    decompressLeaves();
+    if (!updateIndexEnabled) {
+        if (!remove(Object<Payload>(oldBox, id))) return false;
+        insert(Object<Payload>(newBox, id));
+        return true;
+    }
+    if (updateIndexStale) rebuildUpdateIndex();
+
+    Node* leaf = nullptr;
+    if constexpr (isHashable<Payload>::value) {
+        auto found = leafOf.find(id);
+        if (found != leafOf.end()) leaf = found->second;
+    }
+    size_t index = leaf ? leafSize(leaf) : 0;
+    for (size_t i = 0; leaf && i < leafSize(leaf); ++i) {
+        if (leaf->payloads[i] == id && leafEntryEquals(leaf, i, oldBox)) {
+            index = i;
+            break;
+        }
+    }
+
+    if (!leaf || index == leafSize(leaf)) {
+        // Not in the tree: the object may still be waiting in the delta buffer
+        for (auto& object : buffer) {
+            if (object.payload == id && object == oldBox) {
+                static_cast<Rectangle&>(object) = newBox;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Node* parent = leaf->parent;
+    if (!parent) {
+        setLeafEntry(leaf, index, newBox);
+        return true;
+    }
+
+    // Small move: the new box fits the leaf's entry, possibly grown by the slack
+    Rectangle& leafBox = parent->entries[childIndex(parent, leaf)];
+    Rectangle slackBox = leafBox;
+    for (int d = 0; d < dimensions; ++d) {
+        slackBox.minCoords[d] -= updateSlack;
+        slackBox.maxCoords[d] += updateSlack;
+    }
+    if (slackBox.contains(newBox)) {
+        setLeafEntry(leaf, index, newBox);
+        for (Node* node = leaf; node->parent; node = node->parent) {
+            Rectangle& box = node->parent->entries[childIndex(node->parent, node)];
+            if (!extend(box, newBox)) break;
+        }
+        return true;
+    }
+
+    // Leaving the leaf would underfill it, so take the condensing path
+    if (leafSize(leaf) <= static_cast<size_t>(minEntries)) {
+        remove(Object<Payload>(oldBox, id));
+        insert(Object<Payload>(newBox, id));
+        return true;
+    }
+
+    // Climb to the lowest ancestor covering the new box, tightening the entries left behind
+    removeLeafEntry(leaf, index);
+    Node* ancestor = leaf;
+    while (ancestor->parent) {
+        Node* above = ancestor->parent;
+        Rectangle& box = above->entries[childIndex(above, ancestor)];
+        box = nodeMBR(ancestor);
+        ancestor = above;
+        if (ancestor->parent && ancestor->parent->entries[childIndex(ancestor->parent, ancestor)].contains(newBox))
+            break;
+    }
+    insert(ancestor, newBox, id);
+
+    // Splits climb from the ancestor while nodes overflow
+    for (Node* node = ancestor; overflowing(node); node = node->parent) {
+        if (node == root) {
+            splitRoot();
+            break;
+        }
+        attachSibling(node->parent, childIndex(node->parent, node), splitOff(node));
+    }
+    return true;
+}
+
+template <typename Payload>
+size_t RStarTree<Payload>::childIndex(const Node* parent, const Node* child) const {
+    return find(parent->children.begin(), parent->children.end(), child) - parent->children.begin();
+}
+
+template <typename Payload>
+void RStarTree<Payload>::setLeafEntry(Node* leaf, size_t index, const Rectangle& box) const {
+    if (pointData) {
+        assert(box.isPoint() && "point data trees only hold degenerate boxes");
+        copy(box.minCoords.begin(), box.minCoords.end(), leaf->points.begin() + index * dimensions);
+    } else
+        leaf->entries[index] = box;
+}
+
+// Re-encodes every leaf of a cold or static tree into a byte string (see encodeLeaf) and
+// frees its entries, points, and payloads. Queries decode the leaves they reach; the first
+// insert, remove, update, or optimize decompresses the whole tree again.
+template <typename Payload>
+void RStarTree<Payload>::compressLeaves() {
+    decodedFrom = nullptr;
+    function<void(Node*)> compress = [&](Node* node) {
+        if (!node->isLeaf) {
+            for (auto* child : node->children)
+                compress(child);
+            return;
+        }
+        if (!node->compressed.empty()) return;
+        node->compressed = encodeLeaf(node);
+        node->entries = vector<Rectangle>();
+        node->points = vector<float>();
+        node->payloads = PayloadStore<Payload>();
+    };
+    if (root) compress(root);
+    leavesCompressed = true;
+}
+
+template <typename Payload>
+void RStarTree<Payload>::decompressLeaves() {
+    if (!leavesCompressed) return;
+    leavesCompressed = false;
+    decodedFrom = nullptr;
+    function<void(Node*)> decompress = [&](Node* node) {
+        if (!node->isLeaf) {
+            for (auto* child : node->children)
+                decompress(child);
+            return;
+        }
+        if (node->compressed.empty()) return;
+        decodeLeaf(node->compressed, *node);
+        node->compressed = vector<uint8_t>();
+    };
+    if (root) decompress(root);
+}
+
+// The leaf itself, or its decoded contents when compressed. The decoded copy lives in one
+// scratch node, so it stays valid until another compressed leaf is viewed.
+template <typename Payload>
+const BasicNode<Payload>* RStarTree<Payload>::leafView(const Node* leaf) const {
+    if (leaf->compressed.empty()) return leaf;
+    if (decodedFrom != leaf) {
+        decodeLeaf(leaf->compressed, decodedLeaf);
+        decodedFrom = leaf;
+    }
+    return &decodedLeaf;
+}
+
+// Lossless leaf encoding. Entries are sorted by their first coordinate and written one after
+// another as varints: the first coordinate as the gap to the previous entry, the others as
+// zigzag deltas, upper corners as their distance from the lower ones, and integer payloads
+// as zigzag deltas. Coordinates are deltas of order-preserving integer keys of the float bit
+// patterns, so nearby values share their high bits and decode bit-exactly.
+template <typename Payload>
+vector<uint8_t> RStarTree<Payload>::encodeLeaf(const Node* leaf) const {
+    size_t count = leafSize(leaf);
+    auto low = [&](size_t i, int d) { return pointData ? leaf->points[i * dimensions + d] : leaf->entries[i].minCoords[d]; };
+    vector<size_t> order(count);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return floatKey(low(a, 0)) < floatKey(low(b, 0)); });
+
+    vector<uint8_t> bytes(sizeof(uint32_t));
+    uint32_t header = static_cast<uint32_t>(count);
+    memcpy(bytes.data(), &header, sizeof(header));
+    vector<uint32_t> previous(dimensions, 0);
+    uint64_t previousPayload = 0;
+
+    for (size_t i : order) {
+        for (int d = 0; d < dimensions; ++d) {
+            uint32_t key = floatKey(low(i, d));
+            int64_t delta = static_cast<int64_t>(key) - previous[d];
+            putVarint(bytes, d == 0 ? static_cast<uint64_t>(delta) : (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+            previous[d] = key;
+        }
+        if (!pointData) {
+            for (int d = 0; d < dimensions; ++d)
+                putVarint(bytes, floatKey(leaf->entries[i].maxCoords[d]) - floatKey(leaf->entries[i].minCoords[d]));
+        }
+
+        if constexpr (is_integral<Payload>::value) {
+            uint64_t payload = static_cast<uint64_t>(leaf->payloads[i]);
+            int64_t delta = static_cast<int64_t>(payload - previousPayload);
+            putVarint(bytes, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+            previousPayload = payload;
+        } else if constexpr (!is_empty<Payload>::value) {
+            static_assert(is_trivially_copyable<Payload>::value, "compressed leaves copy payloads bytewise");
+            Payload payload = leaf->payloads[i];
+            const uint8_t* raw = reinterpret_cast<const uint8_t*>(&payload);
+            bytes.insert(bytes.end(), raw, raw + sizeof(Payload));
+        }
+    }
+    bytes.shrink_to_fit();
+    return bytes;
+}
+
+// Reuses the leaf's vectors (and each entry's coordinate vectors), so decoding into the same
+// scratch node over and over does not allocate
+template <typename Payload>
+void RStarTree<Payload>::decodeLeaf(const vector<uint8_t>& bytes, Node& leaf) const {
+    uint32_t count;
+    memcpy(&count, bytes.data(), sizeof(count));
+    const uint8_t* in = bytes.data() + sizeof(count);
+
+    if (pointData)
+        leaf.points.resize(static_cast<size_t>(count) * dimensions);
+    else
+        leaf.entries.resize(count);
+    leaf.payloads.resize(count);
+    vector<uint32_t> previous(dimensions, 0);
+    uint64_t previousPayload = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        float* lowCoords;
+        if (pointData) {
+            lowCoords = &leaf.points[i * dimensions];
+        } else {
+            leaf.entries[i].minCoords.resize(dimensions);
+            leaf.entries[i].maxCoords.resize(dimensions);
+            lowCoords = leaf.entries[i].minCoords.data();
+        }
+        for (int d = 0; d < dimensions; ++d) {
+            uint64_t value = getVarint(in);
+            previous[d] += d == 0 ? static_cast<uint32_t>(value) : static_cast<uint32_t>((value >> 1) ^ (0 - (value & 1)));
+            lowCoords[d] = keyFloat(previous[d]);
+        }
+        if (!pointData) {
+            for (int d = 0; d < dimensions; ++d)
+                leaf.entries[i].maxCoords[d] = keyFloat(previous[d] + static_cast<uint32_t>(getVarint(in)));
+        }
+
+        if constexpr (is_integral<Payload>::value) {
+            uint64_t value = getVarint(in);
+            previousPayload += (value >> 1) ^ (0 - (value & 1));
+            leaf.payloads[i] = static_cast<Payload>(previousPayload);
+        } else if constexpr (!is_empty<Payload>::value) {
+            memcpy(&leaf.payloads[i], in, sizeof(Payload));
+            in += sizeof(Payload);
+        }
+    }
+}
+
+// Maps float bit patterns to unsigned integers in the same order (negatives flipped)
+template <typename Payload>
+uint32_t RStarTree<Payload>::floatKey(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000U) ? ~bits : bits | 0x80000000U;
+}
+
+template <typename Payload>
+float RStarTree<Payload>::keyFloat(uint32_t key) {
+    uint32_t bits = (key & 0x80000000U) ? key & 0x7FFFFFFFU : ~key;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template <typename Payload>
+void RStarTree<Payload>::putVarint(vector<uint8_t>& bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+// Most gaps fit one byte, so that case returns before the loop
+template <typename Payload>
+uint64_t RStarTree<Payload>::getVarint(const uint8_t*& in) {
+    uint64_t value = *in++;
+    if (value < 0x80) return value;
+    value &= 0x7F;
+    for (int shift = 7;; shift += 7) {
+        uint64_t byte = *in++;
+        value |= (byte & 0x7F) << shift;
+        if (byte < 0x80) return value;
+    }
+}
+
+template <typename Payload>
+vector<Object<Payload>> RStarTree<Payload>::rangeQuery(const Rectangle& query){
+    vector<Object<Payload>> results;
+    if (root && traversal == PREFETCH_BREADTH_FIRST)
+        rangeQueryPrefetch(query, results);
+    else if (root)
+        rangeQuery(root, query, results);
+
+    // Objects still waiting in the delta buffer
+    for (const auto& object : buffer) {
+        if (query.overlapCheck(object))
+            results.push_back(object);
+    }
+    return results;
+}
+
+template <typename Payload>
+void RStarTree<Payload>::rangeQuery(Node* node, const Rectangle& query, vector<Object<Payload>>& results) {
+    if (!node) return;
+
+    if (node->isLeaf && !node->compressed.empty()) {
+        const Node* leaf = leafView(node);
+        for (size_t i = 0; i < leafSize(leaf); ++i) {
+            if (pointData ? pointInBox(&leaf->points[i * dimensions], query) : query.overlapCheck(leaf->entries[i]))
+                results.push_back(leafObject(leaf, i));
+        }
+        return;
+    }
+
+    if (pointData && node->isLeaf) {
+        for (size_t i = 0; i < node->points.size(); i += dimensions) {
+            const float* point = &node->points[i];
+            if (pointInBox(point, query)) {
+                vector<float> coords(point, point + dimensions);
+                results.emplace_back(node->payloads[i / dimensions], coords, coords);
+            }
+        }
+        return;
+    }
 
     for (size_t i = 0; i < node->entries.size(); ++i) {
         const Rectangle& currentEntry = node->entries[i];
         if (query.overlapCheck(currentEntry)) {
             if (node->isLeaf)
-                results.push_back(currentEntry);
+                results.emplace_back(currentEntry, node->payloads[i]);
             else {
                 if (i < node->children.size())
                     rangeQuery(node->children[i], query, results);
@@ -555,7 +1934,795 @@ void RStarTree::rangeQuery(Node* node, const Rectangle& query, vector<Rectangle>
     }
 }
 
-float RStarTree::calculateSizeInMB() const {
+// Breadth-first range query. Each level's qualifying nodes are processed in order while
+// the ones ahead are prefetched in three steps (node, entry arrays, coordinates), so the
+// dependent loads of several siblings are in flight at once instead of one after another.
+template <typename Payload>
+void RStarTree<Payload>::rangeQueryPrefetch(const Rectangle& query, vector<Object<Payload>>& results) {
+    vector<Node*> frontier = {root}, next;
+
+    while (!frontier.empty()) {
+        next.clear();
+        for (size_t i = 0; i < frontier.size(); ++i) {
+            if (i + 2 * PREFETCH_DISTANCE < frontier.size())
+                RSTARTREE_PREFETCH(frontier[i + 2 * PREFETCH_DISTANCE]);
+            if (i + PREFETCH_DISTANCE < frontier.size())
+                prefetchArrays(frontier[i + PREFETCH_DISTANCE]);
+            if (i + PREFETCH_DISTANCE / 2 < frontier.size())
+                prefetchCoordinates(frontier[i + PREFETCH_DISTANCE / 2]);
+
+            Node* node = frontier[i];
+            if (node->isLeaf) {
+                rangeQuery(node, query, results);
+                continue;
+            }
+            for (size_t c = 0; c < node->children.size(); ++c) {
+                if (query.overlapCheck(node->entries[c]))
+                    next.push_back(node->children[c]);
+            }
+        }
+        frontier.swap(next);
+    }
+}
+
+template <typename Payload>
+void RStarTree<Payload>::prefetchArrays(const Node* node) const {
+    const char* first;
+    size_t bytes;
+    if (!node->compressed.empty()) {
+        first = reinterpret_cast<const char*>(node->compressed.data());
+        bytes = node->compressed.size();
+    } else if (pointData && node->isLeaf) {
+        first = reinterpret_cast<const char*>(node->points.data());
+        bytes = node->points.size() * sizeof(float);
+    } else {
+        first = reinterpret_cast<const char*>(node->entries.data());
+        bytes = node->entries.size() * sizeof(Rectangle);
+    }
+    for (size_t offset = 0; offset < bytes; offset += 64)
+        RSTARTREE_PREFETCH(first + offset);
+    if (!node->isLeaf)
+        RSTARTREE_PREFETCH(node->children.data());
+}
+
+// Rectangles keep their coordinates out of line, one more load away than the entry array
+template <typename Payload>
+void RStarTree<Payload>::prefetchCoordinates(const Node* node) const {
+    if (pointData && node->isLeaf) return;
+    for (const auto& entry : node->entries) {
+        RSTARTREE_PREFETCH(entry.minCoords.data());
+        RSTARTREE_PREFETCH(entry.maxCoords.data());
+    }
+}
+
+// Answers a batch of range queries in one shared descent; results[q] belongs to queries[q].
+// Queries are visited in Hilbert order of their centers, so neighbouring windows sit next
+// to each other in the active lists, and every node is read once for all of its active queries.
+template <typename Payload>
+vector<vector<Object<Payload>>> RStarTree<Payload>::rangeQueryBatch(const vector<Rectangle>& queries) const {
+    vector<vector<Object<Payload>>> results(queries.size());
+    if (queries.empty()) return results;
+
+    Rectangle space = Rectangle::combine(queries);
+    auto grid = [&space](const Rectangle& query, int dim) {
+        float extent = space.maxCoords[dim] - space.minCoords[dim];
+        float center = (query.minCoords[dim] + query.maxCoords[dim]) / 2.0F;
+        return extent > 0.0F ? static_cast<uint32_t>((center - space.minCoords[dim]) / extent * 65535.0F) : 0U;
+    };
+    vector<pair<uint64_t, uint32_t>> keys(queries.size());
+    for (size_t q = 0; q < queries.size(); ++q)
+        keys[q] = {hilbertKey(grid(queries[q], 0), dimensions > 1 ? grid(queries[q], 1) : 0U), static_cast<uint32_t>(q)};
+    sort(keys.begin(), keys.end());
+
+    // One scratch level per depth, sized for every query up front so the descent never allocates
+    size_t depths = 1;
+    for (const Node* node = root; node && !node->isLeaf; node = node->children.front())
+        ++depths;
+    size_t n = queries.size();
+    vector<BatchLevel> levels(depths);
+    for (auto& level : levels) {
+        level.active.reserve(n);
+        level.bounds.resize(2 * dimensions * n);
+        level.cover.resize(2 * dimensions);
+        level.hits.resize(n);
+    }
+
+    // Bounds of the active queries as one array per coordinate: low d at [d * n], high d at [(dimensions + d) * n]
+    BatchLevel& top = levels.front();
+    for (size_t k = 0; k < n; ++k) {
+        const Rectangle& query = queries[keys[k].second];
+        top.active.push_back(keys[k].second);
+        for (int d = 0; d < dimensions; ++d) {
+            top.bounds[d * n + k] = query.minCoords[d];
+            top.bounds[(dimensions + d) * n + k] = query.maxCoords[d];
+        }
+    }
+    for (int d = 0; d < dimensions; ++d) {
+        top.cover[d] = space.minCoords[d];
+        top.cover[dimensions + d] = space.maxCoords[d];
+    }
+    if (root) rangeQueryBatch(root, 0, levels, results);
+
+    for (const auto& object : buffer) {
+        for (size_t q = 0; q < n; ++q) {
+            if (queries[q].overlapCheck(object))
+                results[q].push_back(object);
+        }
+    }
+    return results;
+}
+
+template <typename Payload>
+void RStarTree<Payload>::rangeQueryBatch(const Node* node, size_t depth, vector<BatchLevel>& levels, vector<vector<Object<Payload>>>& results) const {
+    if (node->isLeaf) node = leafView(node);
+    BatchLevel& level = levels[depth];
+    size_t n = level.active.size();
+    size_t count = leafSize(node);
+    unsigned char* hits = level.hits.data();
+
+    for (size_t i = 0; i < count; ++i) {
+        const float* low;
+        const float* high;
+        if (pointData && node->isLeaf) {
+            low = high = &node->points[i * dimensions];
+        } else {
+            low = node->entries[i].minCoords.data();
+            high = node->entries[i].maxCoords.data();
+        }
+
+        // Entries missing the box around all the active queries are skipped without testing each
+        bool inCover = true;
+        for (int d = 0; d < dimensions && inCover; ++d)
+            inCover = level.cover[d] <= high[d] && level.cover[dimensions + d] >= low[d];
+        if (!inCover) continue;
+
+        // Branch-free test of the entry against every active query, one coordinate at a time
+        fill(hits, hits + n, 1);
+        for (int d = 0; d < dimensions; ++d) {
+            const float* queryLow = &level.bounds[d * n];
+            const float* queryHigh = &level.bounds[(dimensions + d) * n];
+            for (size_t k = 0; k < n; ++k)
+                hits[k] &= (queryLow[k] <= high[d]) & (queryHigh[k] >= low[d]);
+        }
+        size_t matches = 0, last = 0;
+        for (size_t k = 0; k < n; ++k) {
+            matches += hits[k];
+            if (hits[k]) last = k;
+        }
+        if (matches == 0) continue;
+
+        if (node->isLeaf) {
+            // Adjacent windows rarely share an object, so the single match takes it without a copy
+            if (matches == 1) {
+                results[level.active[last]].push_back(leafObject(node, i));
+                continue;
+            }
+            Object<Payload> object = leafObject(node, i);
+            for (size_t k = 0; k < n; ++k) {
+                if (hits[k]) results[level.active[k]].push_back(object);
+            }
+            continue;
+        }
+
+        // The child's active queries, compacted into the next level's scratch
+        BatchLevel& next = levels[depth + 1];
+        next.active.clear();
+        for (int d = 0; d < dimensions; ++d) {
+            next.cover[d] = numeric_limits<float>::max();
+            next.cover[dimensions + d] = numeric_limits<float>::lowest();
+        }
+        for (size_t k = 0; k < n; ++k) {
+            if (!hits[k]) continue;
+            size_t j = next.active.size();
+            for (int c = 0; c < 2 * dimensions; ++c)
+                next.bounds[c * matches + j] = level.bounds[c * n + k];
+            for (int d = 0; d < dimensions; ++d) {
+                next.cover[d] = min(next.cover[d], level.bounds[d * n + k]);
+                next.cover[dimensions + d] = max(next.cover[dimensions + d], level.bounds[(dimensions + d) * n + k]);
+            }
+            next.active.push_back(level.active[k]);
+        }
+        rangeQueryBatch(node->children[i], depth + 1, levels, results);
+    }
+}
+
+// Position of cell (x, y) along a Hilbert curve over a 2^16 x 2^16 grid
+template <typename Payload>
+uint64_t RStarTree<Payload>::hilbertKey(uint32_t x, uint32_t y) {
+    uint64_t key = 0;
+    for (uint32_t half = 1U << 15; half > 0; half >>= 1) {
+        uint32_t rx = (x & half) ? 1 : 0;
+        uint32_t ry = (y & half) ? 1 : 0;
+        key += static_cast<uint64_t>(half) * half * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = 65535 - x;
+                y = 65535 - y;
+            }
+            swap(x, y);
+        }
+    }
+    return key;
+}
+
+// Returns the objects that satisfy all the predicates
+template <typename Payload>
+vector<Object<Payload>> RStarTree<Payload>::query(const vector<Predicate>& predicates) {
+    vector<Object<Payload>> results;
+    if (root) query(root, predicates, results);
+
+    for (const auto& object : buffer) {
+        if (all_of(predicates.begin(), predicates.end(), [&object](const Predicate& p) { return p.matches(object); }))
+            results.push_back(object);
+    }
+    return results;
+}
+
+template <typename Payload>
+void RStarTree<Payload>::query(Node* node, const vector<Predicate>& predicates, vector<Object<Payload>>& results) {
+    if (node->isLeaf) {
+        const Node* leaf = leafView(node);
+        for (size_t i = 0; i < leafSize(leaf); ++i) {
+            if (leafEntryMatches(leaf, i, predicates))
+                results.push_back(leafObject(leaf, i));
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < node->children.size(); ++i) {
+        const Rectangle& mbr = node->entries[i];
+        if (!all_of(predicates.begin(), predicates.end(), [&mbr](const Predicate& p) { return p.mayMatch(mbr); }))
+            continue;
+
+        // Every object below qualifies, so emit the subtree without testing its entries
+        if (all_of(predicates.begin(), predicates.end(), [&mbr](const Predicate& p) { return p.matchesAll(mbr); })) {
+            forEachObject(node->children[i], [&results](const Rectangle& box, const Payload& payload) {
+                results.emplace_back(box, payload);
+            });
+        } else {
+            query(node->children[i], predicates, results);
+        }
+    }
+}
+
+template <typename Payload>
+bool RStarTree<Payload>::leafEntryMatches(const Node* leaf, size_t index, const vector<Predicate>& predicates) const {
+    leaf = leafView(leaf);
+    for (const auto& predicate : predicates) {
+        bool match = pointData ? predicate.matchesPoint(&leaf->points[index * dimensions]) : predicate.matches(leaf->entries[index]);
+        if (!match) return false;
+    }
+    return true;
+}
+
+template <typename Payload>
+Object<Payload> RStarTree<Payload>::leafObject(const Node* leaf, size_t index) const {
+    leaf = leafView(leaf);
+    if (!pointData)
+        return Object<Payload>(leaf->entries[index], leaf->payloads[index]);
+
+    vector<float> point(leaf->points.begin() + index * dimensions, leaf->points.begin() + (index + 1) * dimensions);
+    return Object<Payload>(leaf->payloads[index], point, point);
+}
+
+template <typename Payload>
+QueryCursor<Payload> RStarTree<Payload>::cursor(const Rectangle& query) const {
+    return QueryCursor<Payload>(*this, {Predicate::intersects(query)});
+}
+
+template <typename Payload>
+QueryCursor<Payload> RStarTree<Payload>::cursor(const vector<Predicate>& predicates) const {
+    return QueryCursor<Payload>(*this, predicates);
+}
+
+template <typename Payload>
+CompactTree<Payload> RStarTree<Payload>::compact(typename CompactTree<Payload>::Layout layout) const {
+    return CompactTree<Payload>(*this, layout);
+}
+
+// Calls visit(box, payload) for every object, including the buffered ones
+template <typename Payload>
+template <typename Visitor>
+void RStarTree<Payload>::forEachObject(Visitor visit) const {
+    if (root) forEachObject(root, visit);
+    for (const auto& object : buffer)
+        visit(object, object.payload);
+}
+
+template <typename Payload>
+template <typename Visitor>
+void RStarTree<Payload>::forEachObject(const Node* node, Visitor&& visit) const {
+    if (!node->isLeaf) {
+        for (const auto* child : node->children)
+            forEachObject(child, visit);
+        return;
+    }
+    node = leafView(node);
+
+    if (pointData) {
+        for (size_t i = 0; i < leafSize(node); ++i) {
+            vector<float> point(node->points.begin() + i * dimensions, node->points.begin() + (i + 1) * dimensions);
+            visit(Rectangle(point, point), node->payloads[i]);
+        }
+    } else {
+        for (size_t i = 0; i < node->entries.size(); ++i)
+            visit(node->entries[i], node->payloads[i]);
+    }
+}
+
+// Walks the tree level by level and measures how well it is shaped
+template <typename Payload>
+TreeStats RStarTree<Payload>::analyze() const {
+    TreeStats stats;
+    if (!root) return stats;
+    forEachObject([&stats](const Rectangle&, const Payload&) { ++stats.objects; });
+
+    vector<const Node*> level = {root};
+    vector<Rectangle> mbrs = {nodeMBR(root)};
+    double siblingOverlap = 0.0;
+
+    for (int depth = 0; !level.empty(); ++depth) {
+        LevelStats current;
+        current.depth = depth;
+        current.leaves = level.front()->isLeaf;
+        current.nodes = level.size();
+        current.overlap = siblingOverlap;
+        siblingOverlap = 0.0;
+
+        vector<const Node*> nextLevel;
+        vector<Rectangle> nextMbrs;
+
+        for (size_t n = 0; n < level.size(); ++n) {
+            const Node* node = level[n];
+            const Rectangle& mbr = mbrs[n];
+            size_t count = leafSize(node);
+            float fill = static_cast<float>(count) / maxEntries;
+
+            current.entries += count;
+            current.minFill = min(current.minFill, fill);
+            current.maxFill = max(current.maxFill, fill);
+            current.avgFill += fill / level.size();
+            current.fillHistogram[min(static_cast<size_t>(fill * 10), static_cast<size_t>(9))]++;
+            current.area += mbr.getArea();
+            current.deadSpace += deadSpace(node, mbr);
+            for (int d = 0; d < dimensions; ++d)
+                current.margin += mbr.maxCoords[d] - mbr.minCoords[d];
+
+            // The children are siblings, so their overlap belongs to the next level
+            for (size_t i = 0; i < node->children.size(); ++i) {
+                for (size_t j = i + 1; j < node->children.size(); ++j)
+                    siblingOverlap += node->entries[i].getOverlapArea(node->entries[j]);
+                nextLevel.push_back(node->children[i]);
+                nextMbrs.push_back(node->entries[i]);
+            }
+        }
+
+        stats.levels.push_back(current);
+        level.swap(nextLevel);
+        mbrs.swap(nextMbrs);
+    }
+    return stats;
+}
+
+// MBR area minus the area covered by the entries (union estimated by inclusion-exclusion over pairs)
+template <typename Payload>
+double RStarTree<Payload>::deadSpace(const Node* node, const Rectangle& mbr) const {
+    double area = mbr.getArea();
+    if (pointData && node->isLeaf) return area;
+    if (node->isLeaf) node = leafView(node);
+
+    double covered = 0.0;
+    for (size_t i = 0; i < node->entries.size(); ++i) {
+        covered += node->entries[i].getArea();
+        for (size_t j = i + 1; j < node->entries.size(); ++j)
+            covered -= node->entries[i].getOverlapArea(node->entries[j]);
+    }
+    return area - min(max(covered, 0.0), area);
+}
+
+// Expected nodes visited by a query of the given extent, placed uniformly inside the root MBR:
+// each node is visited with probability prod_d min(1, (nodeExtent_d + queryExtent_d) / rootExtent_d)
+template <typename Payload>
+double RStarTree<Payload>::expectedNodeAccesses(const vector<float>& querySize) const {
+    if (!root || leafSize(root) == 0) return 0.0;
+
+    Rectangle space = nodeMBR(root);
+    double accesses = 1.0;
+    vector<const Node*> stack = {root};
+
+    while (!stack.empty()) {
+        const Node* node = stack.back();
+        stack.pop_back();
+
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            double probability = 1.0;
+            for (int d = 0; d < dimensions; ++d) {
+                double extent = space.maxCoords[d] - space.minCoords[d];
+                double reach = node->entries[i].maxCoords[d] - node->entries[i].minCoords[d] + querySize[d];
+                probability *= extent > 0.0 ? min(1.0, reach / extent) : 1.0;
+            }
+            accesses += probability;
+            stack.push_back(node->children[i]);
+        }
+    }
+    return accesses;
+}
+
+// Selectivity estimate that reads only the top of the tree. Each child MBR meeting the box
+// contributes its subtree size times the fraction of the MBR the box covers (all of it when
+// fully covered, assuming uniform spread inside). The partially covered child with the most
+// objects at stake is then expanded, up to maxDepth levels below the root, until the gap
+// between lowGuess and highGuess is within errorBound of the estimate. Expanded leaves count exactly.
+template <typename Payload>
+CountEstimate RStarTree<Payload>::estimateCount(const Rectangle& box, int maxDepth, double errorBound) const {
+    CountEstimate result;
+    for (const auto& object : buffer) {
+        if (box.overlapCheck(object))
+            result.estimate += 1.0;
+    }
+    result.lowGuess = result.highGuess = result.estimate;
+    if (!root) return result;
+
+    struct Partial {
+        const Node* node;
+        int height;
+        int depth;
+        double size;
+        double fraction;
+        bool operator<(const Partial& other) const { return size < other.size; }
+    };
+    priority_queue<Partial> partials;
+    vector<double> sizes = typicalSubtreeSizes();
+
+    auto expand = [&](const Node* node, int height, int depth) {
+        ++result.nodesVisited;
+        if (node->isLeaf) {
+            node = leafView(node);
+            for (size_t i = 0; i < leafSize(node); ++i) {
+                bool match = pointData ? pointInBox(&node->points[i * dimensions], box) : box.overlapCheck(node->entries[i]);
+                if (match) {
+                    result.estimate += 1.0;
+                    result.lowGuess += 1.0;
+                    result.highGuess += 1.0;
+                }
+            }
+            return;
+        }
+
+        double size = sizes[height - 1];
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            const Rectangle& entry = node->entries[i];
+            if (!box.overlapCheck(entry)) continue;
+
+            if (box.contains(entry)) {
+                result.estimate += size;
+                result.lowGuess += size;
+                result.highGuess += size;
+            } else {
+                double fraction = coverage(entry, box);
+                result.estimate += fraction * size;
+                result.highGuess += size;
+                partials.push({node->children[i], height - 1, depth + 1, size, fraction});
+            }
+        }
+    };
+
+    expand(root, static_cast<int>(sizes.size()) - 1, 0);
+    while (!partials.empty() && result.highGuess - result.lowGuess > errorBound * max(result.estimate, 1.0)) {
+        Partial partial = partials.top();
+        partials.pop();
+        if (partial.depth > maxDepth) continue;
+
+        // Swap the node's guess for what its entries say
+        result.estimate -= partial.fraction * partial.size;
+        result.highGuess -= partial.size;
+        expand(partial.node, partial.height, partial.depth);
+    }
+    return result;
+}
+
+// Typical number of objects below a node of each height (0 = leaf), a heuristic taken from
+// the average fanout of one node per level along the leftmost path. Other subtrees of the same
+// height may hold anywhere from a few to maxEntries^(height + 1) objects.
+template <typename Payload>
+vector<double> RStarTree<Payload>::typicalSubtreeSizes() const {
+    vector<double> fanouts;
+    for (const Node* node = root; node; node = node->isLeaf ? nullptr : node->children.front()) {
+        if (node->isLeaf) {
+            fanouts.push_back(static_cast<double>(leafSize(node)));
+            break;
+        }
+        double children = 0.0;
+        for (const auto* child : node->children)
+            children += leafSize(child);
+        fanouts.push_back(children / node->children.size());
+    }
+
+    // fanouts[0] describes the root's children, fanouts.back() the leaves
+    vector<double> sizes;
+    double size = 1.0;
+    for (size_t level = fanouts.size(); level-- > 0;) {
+        size *= fanouts[level];
+        sizes.push_back(size);
+    }
+    return sizes;
+}
+
+// Fraction of the entry's volume inside the box; flat dimensions count as fully in or out
+template <typename Payload>
+double RStarTree<Payload>::coverage(const Rectangle& entry, const Rectangle& box) const {
+    double fraction = 1.0;
+    for (int d = 0; d < dimensions; ++d) {
+        double extent = entry.maxCoords[d] - entry.minCoords[d];
+        double inside = min(entry.maxCoords[d], box.maxCoords[d]) - max(entry.minCoords[d], box.minCoords[d]);
+        if (inside < 0.0) return 0.0;
+        fraction *= extent > 0.0 ? inside / extent : 1.0;
+    }
+    return fraction;
+}
+
+// Uniform sample of k distinct objects overlapping box (all of them if fewer match), without
+// materializing the result. Nodes carry no subtree counts, so this is acceptance/rejection
+// sampling (Olken and Rotem): a subtree of height h stands for maxEntries^h slots, a walk
+// picks one slot per level and is rejected on an empty slot or a child outside the box, so
+// every matching object is reached with the same probability. The walks start from a
+// frontier of the subtrees meeting the box, expanded below partially covered nodes until it
+// holds about k subtrees, which keeps the rejection rate low.
+// Walks only pay off when the window holds many more matches than k. When the frontier
+// reaches the leaves, or the matches estimated from it (typical subtree sizes times the
+// covered fraction) are within a few times k, the matches are listed instead and k of them
+// drawn directly. The same listing is the fallback when the walks miss too often (at most
+// 32 attempts per sample) or a node exceeds maxEntries (leaves only grow past it through
+// single inserts).
+template <typename Payload>
+template <typename Rng>
+vector<Object<Payload>> RStarTree<Payload>::sample(const Rectangle& box, size_t k, Rng& rng) {
+    vector<Object<Payload>> result;
+    if (k == 0) return result;
+
+    struct Subtree {
+        const Node* node;
+        int height;
+        bool contained;
+        double fraction;
+    };
+    vector<Subtree> frontier;
+    if (root && leafSize(root) > 0 && box.overlapCheck(nodeMBR(root))) {
+        int height = 0;
+        for (const Node* node = root; !node->isLeaf; node = node->children.front())
+            ++height;
+        Rectangle mbr = nodeMBR(root);
+        frontier.push_back({root, height, box.contains(mbr), coverage(mbr, box)});
+    }
+
+    bool expanded = true;
+    while (expanded && frontier.size() < k) {
+        expanded = false;
+        vector<Subtree> next;
+        for (const auto& subtree : frontier) {
+            if (subtree.node->isLeaf || subtree.contained) {
+                next.push_back(subtree);
+                continue;
+            }
+            expanded = true;
+            for (size_t i = 0; i < subtree.node->children.size(); ++i) {
+                const Rectangle& entry = subtree.node->entries[i];
+                if (box.overlapCheck(entry))
+                    next.push_back({subtree.node->children[i], subtree.height - 1, box.contains(entry), coverage(entry, box)});
+            }
+        }
+        frontier.swap(next);
+    }
+
+    // Buffered matches are listed exactly and weighted as leaf slots
+    vector<size_t> bufferMatches;
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        if (box.overlapCheck(buffer[i]))
+            bufferMatches.push_back(i);
+    }
+
+    // Drawn objects as (leaf, slot), or (nullptr, index) for the buffer
+    vector<pair<const Node*, size_t>> drawn;
+    auto materialize = [&]() {
+        result.reserve(drawn.size());
+        for (const auto& object : drawn)
+            result.push_back(object.first ? leafObject(object.first, object.second) : buffer[object.second]);
+        return result;
+    };
+
+    // Lists every match below the frontier and draws k of them by a partial shuffle
+    auto drawFromMatches = [&]() {
+        drawn.clear();
+        vector<pair<const Node*, bool>> stack;
+        for (const auto& subtree : frontier)
+            stack.push_back({subtree.node, subtree.contained});
+        while (!stack.empty()) {
+            const Node* node = stack.back().first;
+            bool contained = stack.back().second;
+            stack.pop_back();
+            if (node->isLeaf) {
+                const Node* leaf = leafView(node);
+                for (size_t i = 0; i < leafSize(leaf); ++i) {
+                    if (contained || (pointData ? pointInBox(&leaf->points[i * dimensions], box) : box.overlapCheck(leaf->entries[i])))
+                        drawn.push_back({node, i});
+                }
+                continue;
+            }
+            for (size_t i = 0; i < node->children.size(); ++i) {
+                if (contained || box.overlapCheck(node->entries[i]))
+                    stack.push_back({node->children[i], contained || box.contains(node->entries[i])});
+            }
+        }
+        for (size_t index : bufferMatches)
+            drawn.push_back({nullptr, index});
+        for (size_t i = 0; i < min(k, drawn.size()); ++i)
+            swap(drawn[i], drawn[uniform_int_distribution<size_t>(i, drawn.size() - 1)(rng)]);
+        if (drawn.size() > k) drawn.resize(k);
+        return materialize();
+    };
+
+    // Small or saturated windows: listing beats walks that mostly miss or redraw
+    const double listingFactor = 4.0;
+    bool leavesOnly = all_of(frontier.begin(), frontier.end(), [](const Subtree& subtree) { return subtree.node->isLeaf; });
+    if (leavesOnly) return drawFromMatches();
+    vector<double> sizes = typicalSubtreeSizes();
+    double expectedMatches = bufferMatches.size();
+    for (const auto& subtree : frontier)
+        expectedMatches += subtree.fraction * sizes[subtree.height];
+    if (expectedMatches <= listingFactor * k) return drawFromMatches();
+
+    const double slots = maxEntries;
+    vector<double> cumulative;
+    double total = 0.0;
+    for (const auto& subtree : frontier) {
+        total += pow(slots, subtree.height + 1);
+        cumulative.push_back(total);
+    }
+    total += bufferMatches.size();
+
+    uniform_real_distribution<double> pickSubtree(0.0, total);
+    uniform_int_distribution<size_t> pickSlot(0, maxEntries - 1);
+    const size_t maxAttempts = 32 * k;
+    size_t distinct = 0;
+    drawn.reserve(k);
+
+    // Walks add objects until k are drawn, then repeats are dropped and the walks go on:
+    // the same as rejecting each repeat as it is drawn, without a lookup per walk
+    for (size_t attempt = 0; attempt < maxAttempts && distinct < k; ++attempt) {
+        size_t start = upper_bound(cumulative.begin(), cumulative.end(), pickSubtree(rng)) - cumulative.begin();
+        if (start == frontier.size()) {
+            drawn.push_back({nullptr, bufferMatches[uniform_int_distribution<size_t>(0, bufferMatches.size() - 1)(rng)]});
+        } else {
+            const Node* node = frontier[start].node;
+            bool contained = frontier[start].contained;
+            while (true) {
+                size_t size = leafSize(node);
+                if (size > static_cast<size_t>(maxEntries)) return drawFromMatches();
+                size_t slot = pickSlot(rng);
+                if (slot >= size) break;
+
+                if (node->isLeaf) {
+                    const Node* leaf = leafView(node);
+                    if (contained || (pointData ? pointInBox(&leaf->points[slot * dimensions], box) : box.overlapCheck(leaf->entries[slot])))
+                        drawn.push_back({node, slot});
+                    break;
+                }
+                if (!contained && !box.overlapCheck(node->entries[slot])) break;
+                node = node->children[slot];
+            }
+        }
+        if (drawn.size() == k) {
+            sort(drawn.begin(), drawn.end());
+            drawn.erase(unique(drawn.begin(), drawn.end()), drawn.end());
+            distinct = drawn.size();
+        }
+    }
+    if (distinct == k) return materialize();
+    return drawFromMatches();
+}
+
+// Top-k by score: every node keeps an upper bound on the scores below it (maxScore), kept
+// by inserts, splits, removals, and bulk loads. An empty function turns scores off again.
+template <typename Payload>
+void RStarTree<Payload>::enableScores(function<float(const Payload&)> scoreOf) {
+    score = move(scoreOf);
+    function<void(Node*)> refresh = [&](Node* node) {
+        for (auto* child : node->children)
+            refresh(child);
+        refreshMaxScore(node);
+    };
+    if (root) refresh(root);
+}
+
+// Recomputes the node's bound from its own objects or from its children's bounds
+template <typename Payload>
+void RStarTree<Payload>::refreshMaxScore(Node* node) const {
+    if (!score) return;
+
+    float best = -numeric_limits<float>::infinity();
+    if (node->isLeaf) {
+        const Node* leaf = leafView(node);
+        for (size_t i = 0; i < leafSize(leaf); ++i)
+            best = max(best, score(leaf->payloads[i]));
+    } else {
+        for (const auto* child : node->children)
+            best = max(best, child->maxScore);
+    }
+    node->maxScore = best;
+}
+
+// The k highest-scoring objects intersecting the box, highest first. Nodes are visited best
+// first by maxScore, and the search stops once no pending node can beat the current k-th score,
+// so the cost follows k rather than the number of objects in the box.
+template <typename Payload>
+vector<Object<Payload>> RStarTree<Payload>::topK(const Rectangle& box, size_t k) const {
+    if (!score) {
+        cerr << "Error: topK needs a score function, see enableScores" << endl;
+        return {};
+    }
+    if (k == 0) return {};
+
+    struct Candidate {
+        float score;
+        const Node* leaf; // nullptr: buffer[index]
+        size_t index;
+        bool operator<(const Candidate& other) const { return score > other.score; }
+    };
+    struct Pending {
+        float maxScore;
+        const Node* node;
+        bool operator<(const Pending& other) const { return maxScore < other.maxScore; }
+    };
+
+    priority_queue<Candidate> best; // Lowest of the current top k on top
+    auto threshold = [&]() { return best.size() < k ? -numeric_limits<float>::infinity() : best.top().score; };
+    auto offer = [&](float value, const Node* leaf, size_t index) {
+        if (best.size() < k) {
+            best.push({value, leaf, index});
+        } else if (value > best.top().score) {
+            best.pop();
+            best.push({value, leaf, index});
+        }
+    };
+
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        if (box.overlapCheck(buffer[i]))
+            offer(score(buffer[i].payload), nullptr, i);
+    }
+
+    priority_queue<Pending> pending;
+    if (root && leafSize(root) > 0) pending.push({root->maxScore, root});
+    while (!pending.empty() && (best.size() < k || pending.top().maxScore > threshold())) {
+        const Node* node = pending.top().node;
+        pending.pop();
+
+        if (!node->isLeaf) {
+            for (size_t i = 0; i < node->children.size(); ++i) {
+                const Node* child = node->children[i];
+                if (box.overlapCheck(node->entries[i]) && (best.size() < k || child->maxScore > threshold()))
+                    pending.push({child->maxScore, child});
+            }
+            continue;
+        }
+
+        const Node* leaf = leafView(node);
+        for (size_t i = 0; i < leafSize(leaf); ++i) {
+            if (pointData ? pointInBox(&leaf->points[i * dimensions], box) : box.overlapCheck(leaf->entries[i]))
+                offer(score(leaf->payloads[i]), node, i);
+        }
+    }
+
+    vector<Object<Payload>> result;
+    for (; !best.empty(); best.pop()) {
+        const Candidate& candidate = best.top();
+        result.push_back(candidate.leaf ? leafObject(candidate.leaf, candidate.index) : buffer[candidate.index]);
+    }
+    reverse(result.begin(), result.end());
+    return result;
+}
+
+template <typename Payload>
+float RStarTree<Payload>::calculateSizeInMB() const {
     size_t totalSize = 0;
 
     function<void(const Node*)> calculateNodeSize = [&](const Node* node) {
@@ -565,13 +2732,17 @@ float RStarTree::calculateSizeInMB() const {
         totalSize += sizeof(Node*); 
         totalSize += sizeof(vector<Node*>);
         totalSize += sizeof(vector<Rectangle>); 
-
-        // Ignore data points
-        if (!node->isLeaf) {
-            totalSize += node->entries.size() * sizeof(Rectangle);
-
-            for (const auto& rectangle : node->entries)
-                totalSize += 2 * (dimensions * sizeof(float));
+        totalSize += sizeof(PayloadStore<Payload>);
+        totalSize += sizeof(vector<uint8_t>);
+
+        // Leaves count what they actually hold: encoded bytes when compressed
+        if (!node->compressed.empty()) {
+            totalSize += node->compressed.size();
+        } else {
+            totalSize += node->entries.size() * (sizeof(Rectangle) + 2 * dimensions * sizeof(float));
+            totalSize += node->points.size() * sizeof(float);
+            if (!is_empty<Payload>::value)
+                totalSize += node->payloads.size() * sizeof(Payload);
         }
 
         totalSize += node->children.size() * sizeof(Node*);
@@ -585,4 +2756,264 @@ float RStarTree::calculateSizeInMB() const {
     return static_cast<float>(totalSize) / (1024.0F * 1024.0F); 
 }
 
+/////////////////////
+// QueryCursor
+/////////////////////
+
+// Pull-based query: an explicit traversal stack yields matches one at a time (or a page at
+// a time), so the first results arrive before the whole result set exists and memory is
+// bounded by the page size. A cursor can be kept and resumed later, or simply dropped.
+// Modifying the tree invalidates its open cursors.
+template <typename Payload>
+class QueryCursor {
+public:
+    struct Frame {
+        const BasicNode<Payload>* node;
+        size_t index;
+        bool emitAll; // Every object below matches, so skip the predicate tests
+    };
+
+    const RStarTree<Payload>* tree;
+    vector<Predicate> predicates;
+    vector<Frame> stack;
+    size_t bufferIndex;
+
+    QueryCursor(const RStarTree<Payload>& tree, const vector<Predicate>& predicates);
+    bool next(Object<Payload>& object);
+    size_t next(size_t count, vector<Object<Payload>>& objects);
+    bool done() const;
+};
+
+template <typename Payload>
+QueryCursor<Payload>::QueryCursor(const RStarTree<Payload>& tree, const vector<Predicate>& predicates)
+    : tree(&tree), predicates(predicates), bufferIndex(0) {
+    if (tree.root) stack.push_back({tree.root, 0, false});
+}
+
+template <typename Payload>
+bool QueryCursor<Payload>::next(Object<Payload>& object) {
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const BasicNode<Payload>* node = frame.node;
+
+        if (node->isLeaf) {
+            while (frame.index < tree->leafSize(node)) {
+                size_t i = frame.index++;
+                if (frame.emitAll || tree->leafEntryMatches(node, i, predicates)) {
+                    object = tree->leafObject(node, i);
+                    return true;
+                }
+            }
+            stack.pop_back();
+            continue;
+        }
+
+        if (frame.index >= node->children.size()) {
+            stack.pop_back();
+            continue;
+        }
+
+        size_t i = frame.index++;
+        const Rectangle& mbr = node->entries[i];
+        if (frame.emitAll) {
+            stack.push_back({node->children[i], 0, true});
+        } else if (all_of(predicates.begin(), predicates.end(), [&mbr](const Predicate& p) { return p.mayMatch(mbr); })) {
+            bool emitAll = all_of(predicates.begin(), predicates.end(), [&mbr](const Predicate& p) { return p.matchesAll(mbr); });
+            stack.push_back({node->children[i], 0, emitAll});
+        }
+    }
+
+    // Objects still waiting in the delta buffer
+    while (bufferIndex < tree->buffer.size()) {
+        const Object<Payload>& candidate = tree->buffer[bufferIndex++];
+        if (all_of(predicates.begin(), predicates.end(), [&candidate](const Predicate& p) { return p.matches(candidate); })) {
+            object = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Appends up to count matches and returns how many were added
+template <typename Payload>
+size_t QueryCursor<Payload>::next(size_t count, vector<Object<Payload>>& objects) {
+    Object<Payload> object;
+    size_t added = 0;
+    while (added < count && next(object)) {
+        objects.push_back(object);
+        ++added;
+    }
+    return added;
+}
+
+template <typename Payload>
+bool QueryCursor<Payload>::done() const {
+    return stack.empty() && bufferIndex >= tree->buffer.size();
+}
+
+/////////////////////
+// CompactTree
+/////////////////////
+
+// Read-only replica of a tree in one contiguous buffer of cache lines. Each node starts on
+// a line with a 16-byte header {count, isLeaf, first payload, unused}, followed by its boxes
+// as flat floats (min then max per entry, or one tuple per point in point leaves) and, in
+// internal nodes, the 32-bit line offsets of its children. Payloads sit in a separate array
+// in leaf order. Nodes are placed breadth-first, or in van Emde Boas order, which keeps
+// every subtree of half the height together so a root-to-leaf path touches few pages.
+// Later changes to the source tree are not reflected.
+template <typename Payload>
+class CompactTree {
+public:
+    enum Layout { BREADTH_FIRST, VAN_EMDE_BOAS };
+    struct alignas(64) CacheLine {
+        unsigned char bytes[64];
+    };
+
+    int dimensions;
+    bool pointData;
+    vector<CacheLine> lines;
+    vector<Payload> payloads;
+    vector<Object<Payload>> buffer;
+
+    CompactTree(const RStarTree<Payload>& tree, Layout layout);
+    vector<Object<Payload>> rangeQuery(const Rectangle& query) const;
+    size_t sizeInBytes() const;
+
+private:
+    using Node = BasicNode<Payload>;
+
+    void orderVEB(const Node* node, int height, vector<const Node*>& order) const;
+    size_t nodeLines(const RStarTree<Payload>& tree, const Node* node) const;
+};
+
+template <typename Payload>
+CompactTree<Payload>::CompactTree(const RStarTree<Payload>& tree, Layout layout)
+    : dimensions(tree.dimensions), pointData(tree.pointData), buffer(tree.buffer) {
+    vector<const Node*> order;
+    if (layout == BREADTH_FIRST) {
+        order.push_back(tree.root);
+        for (size_t i = 0; i < order.size(); ++i)
+            order.insert(order.end(), order[i]->children.begin(), order[i]->children.end());
+    } else {
+        int height = 1;
+        for (const Node* node = tree.root; !node->isLeaf; node = node->children.front())
+            ++height;
+        orderVEB(tree.root, height, order);
+    }
+
+    unordered_map<const Node*, uint32_t> offsets;
+    size_t total = 0;
+    for (const auto* node : order) {
+        offsets[node] = static_cast<uint32_t>(total);
+        total += nodeLines(tree, node);
+    }
+    lines.resize(total);
+
+    for (const auto* original : order) {
+        uint32_t* header = reinterpret_cast<uint32_t*>(lines[offsets[original]].bytes);
+        const Node* node = original->isLeaf ? tree.leafView(original) : original;
+        size_t count = tree.leafSize(node);
+        header[0] = static_cast<uint32_t>(count);
+        header[1] = node->isLeaf;
+        header[2] = static_cast<uint32_t>(payloads.size());
+        header[3] = 0;
+
+        float* coords = reinterpret_cast<float*>(header + 4);
+        if (pointData && node->isLeaf) {
+            coords = copy(node->points.begin(), node->points.end(), coords);
+        } else {
+            for (const auto& entry : node->entries) {
+                coords = copy(entry.minCoords.begin(), entry.minCoords.end(), coords);
+                coords = copy(entry.maxCoords.begin(), entry.maxCoords.end(), coords);
+            }
+        }
+
+        if (node->isLeaf) {
+            for (size_t i = 0; i < count; ++i)
+                payloads.push_back(node->payloads[i]);
+        } else {
+            uint32_t* children = reinterpret_cast<uint32_t*>(coords);
+            for (size_t i = 0; i < count; ++i)
+                children[i] = offsets[node->children[i]];
+        }
+    }
+}
+
+// Lays out the top half of the levels recursively, then each subtree hanging below it
+template <typename Payload>
+void CompactTree<Payload>::orderVEB(const Node* node, int height, vector<const Node*>& order) const {
+    if (height == 1) {
+        order.push_back(node);
+        return;
+    }
+
+    int topHeight = height / 2;
+    orderVEB(node, topHeight, order);
+
+    vector<const Node*> bottoms = {node};
+    for (int level = 0; level < topHeight; ++level) {
+        vector<const Node*> below;
+        for (const auto* bottom : bottoms)
+            below.insert(below.end(), bottom->children.begin(), bottom->children.end());
+        bottoms.swap(below);
+    }
+    for (const auto* bottom : bottoms)
+        orderVEB(bottom, height - topHeight, order);
+}
+
+template <typename Payload>
+size_t CompactTree<Payload>::nodeLines(const RStarTree<Payload>& tree, const Node* node) const {
+    size_t count = tree.leafSize(node);
+    size_t floats = count * (pointData && node->isLeaf ? dimensions : 2 * dimensions);
+    size_t bytes = 4 * sizeof(uint32_t) + floats * sizeof(float) + (node->isLeaf ? 0 : count * sizeof(uint32_t));
+    return (bytes + sizeof(CacheLine) - 1) / sizeof(CacheLine);
+}
+
+template <typename Payload>
+vector<Object<Payload>> CompactTree<Payload>::rangeQuery(const Rectangle& query) const {
+    vector<Object<Payload>> results;
+    vector<uint32_t> stack = {0};
+
+    while (!stack.empty()) {
+        const uint32_t* header = reinterpret_cast<const uint32_t*>(lines[stack.back()].bytes);
+        stack.pop_back();
+        uint32_t count = header[0];
+        bool isLeaf = header[1];
+        bool points = pointData && isLeaf;
+        size_t stride = points ? dimensions : 2 * dimensions;
+        const float* coords = reinterpret_cast<const float*>(header + 4);
+        const uint32_t* children = reinterpret_cast<const uint32_t*>(coords + count * stride);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const float* minCoords = coords + i * stride;
+            const float* maxCoords = points ? minCoords : minCoords + dimensions;
+
+            bool overlaps = true;
+            for (int d = 0; d < dimensions && overlaps; ++d)
+                overlaps = query.minCoords[d] <= maxCoords[d] && query.maxCoords[d] >= minCoords[d];
+            if (!overlaps) continue;
+
+            if (isLeaf) {
+                vector<float> low(minCoords, minCoords + dimensions), high(maxCoords, maxCoords + dimensions);
+                results.emplace_back(payloads[header[2] + i], low, high);
+            } else {
+                stack.push_back(children[i]);
+            }
+        }
+    }
+
+    // Objects that were still in the source tree's delta buffer
+    for (const auto& object : buffer) {
+        if (query.overlapCheck(object))
+            results.push_back(object);
+    }
+    return results;
+}
+
+template <typename Payload>
+size_t CompactTree<Payload>::sizeInBytes() const {
+    return lines.size() * sizeof(CacheLine) + payloads.size() * sizeof(Payload);
+}
+
 #endif // RSTARTREE_HPP
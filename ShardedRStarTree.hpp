@@ -0,0 +1,253 @@
+#ifndef SHARDEDRSTARTREE_HPP
+#define SHARDEDRSTARTREE_HPP
+
+#include "RStarTree.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+/////////////////////
+// ShardedRStarTree
+/////////////////////
+
+// Multi-core ingest through spatial sharding: space is cut into shardCount regions (an
+// equal grid over the sample's MBR, or STR slabs and cells at the sample's quantiles, on
+// the first two dimensions), and each region is an independent RStarTree owned by a worker
+// thread that drains its own ingest queue. Queries fan out to the shards whose bounds meet
+// the query and merge the results.
+// Objects straddling regions are either assigned to the region holding their center (the
+// shard's bounds then grow past its region) or duplicated into every region they touch,
+// in which case a result is reported only by the lowest-numbered shard holding it.
+// Inserts are asynchronous: queries see what the workers have applied, so call flush()
+// first for read-your-writes.
+template <typename Payload = int64_t>
+class ShardedRStarTree {
+public:
+    enum Partitioning { GRID, STR };
+    enum StraddlePolicy { ASSIGN_BY_CENTER, DUPLICATE };
+
+    struct Shard {
+        RStarTree<Payload> tree;
+        Rectangle region;                // Outer regions reach to infinity, so the regions cover all of space
+        Rectangle bounds;                // MBR of the stored objects
+        mutex treeLock;                  // Guards tree and bounds between the worker and queries
+        mutex queueLock;                 // Guards queue, busy, and stopping
+        condition_variable ready;
+        condition_variable drained;
+        vector<Object<Payload>> queue;
+        bool busy;
+        bool stopping;
+        thread worker;
+
+        Shard(int maxEntries, int dimensions, bool pointData, const Rectangle& region);
+    };
+
+    int dimensions;
+    StraddlePolicy policy;
+    vector<unique_ptr<Shard>> shards;
+
+    ShardedRStarTree(const vector<Object<Payload>>& sample, size_t shardCount, int maxEntries, int dimensions,
+                     Partitioning partitioning = STR, StraddlePolicy policy = ASSIGN_BY_CENTER, bool pointData = false);
+    ~ShardedRStarTree();
+    void insert(const Object<Payload>& object);
+    void insert(const vector<Object<Payload>>& objects);
+    void flush();
+    vector<Object<Payload>> rangeQuery(const Rectangle& query);
+    vector<Rectangle> partition(const vector<Object<Payload>>& sample, size_t shardCount, Partitioning partitioning) const;
+    vector<size_t> route(const Rectangle& box) const;
+    void work(Shard& shard);
+};
+
+template <typename Payload>
+ShardedRStarTree<Payload>::Shard::Shard(int maxEntries, int dimensions, bool pointData, const Rectangle& region)
+    : tree(maxEntries, dimensions, pointData), region(region), bounds(dimensions), busy(false), stopping(false) {}
+
+template <typename Payload>
+ShardedRStarTree<Payload>::ShardedRStarTree(const vector<Object<Payload>>& sample, size_t shardCount, int maxEntries, int dimensions,
+                                            Partitioning partitioning, StraddlePolicy policy, bool pointData)
+    : dimensions(dimensions), policy(policy) {
+    for (const auto& region : partition(sample, max(shardCount, static_cast<size_t>(1)), partitioning))
+        shards.emplace_back(new Shard(maxEntries, dimensions, pointData, region));
+    for (auto& shard : shards)
+        shard->worker = thread(&ShardedRStarTree::work, this, ref(*shard));
+}
+
+template <typename Payload>
+ShardedRStarTree<Payload>::~ShardedRStarTree() {
+    for (auto& shard : shards) {
+        lock_guard<mutex> guard(shard->queueLock);
+        shard->stopping = true;
+        shard->ready.notify_one();
+    }
+    for (auto& shard : shards)
+        shard->worker.join();
+}
+
+// Splits the first dimension into about sqrt(shardCount) slabs and each slab into cells
+// along the second dimension. GRID cuts the sample's MBR evenly, STR cuts at the quantiles
+// of the sample's centers so every shard receives a similar share of the data.
+template <typename Payload>
+vector<Rectangle> ShardedRStarTree<Payload>::partition(const vector<Object<Payload>>& sample, size_t shardCount, Partitioning partitioning) const {
+    const float infinity = numeric_limits<float>::max();
+    Rectangle space(dimensions);
+    vector<Rectangle> regions;
+    for (const auto& object : sample)
+        space = Rectangle::combine({space, object});
+    if (sample.empty())
+        space = Rectangle(vector<float>(dimensions, 0.0F), vector<float>(dimensions, 1.0F));
+
+    auto center = [](const Rectangle& box, int dim) { return (box.minCoords[dim] + box.maxCoords[dim]) / 2.0F; };
+    auto cut = [&](vector<const Object<Payload>*>& items, int dim, size_t parts, size_t part, float low, float high) {
+        if (partitioning == GRID || items.empty())
+            return low + (high - low) * part / parts;
+        size_t index = items.size() * part / parts;
+        nth_element(items.begin(), items.begin() + index, items.end(), [&](const Object<Payload>* a, const Object<Payload>* b) {
+            return center(*a, dim) < center(*b, dim);
+        });
+        return center(*items[index], dim);
+    };
+
+    vector<const Object<Payload>*> items;
+    for (const auto& object : sample)
+        items.push_back(&object);
+    size_t slabs = max(static_cast<size_t>(1), static_cast<size_t>(sqrt(static_cast<double>(shardCount))));
+    int slabDim = 0, cellDim = dimensions > 1 ? 1 : 0;
+
+    float slabLow = -infinity;
+    for (size_t slab = 0; slab < slabs; ++slab) {
+        float slabHigh = slab + 1 == slabs ? infinity : cut(items, slabDim, slabs, slab + 1, space.minCoords[slabDim], space.maxCoords[slabDim]);
+        vector<const Object<Payload>*> slabItems;
+        for (const auto* item : items) {
+            float c = center(*item, slabDim);
+            if (c >= slabLow && (c < slabHigh || slabHigh == infinity))
+                slabItems.push_back(item);
+        }
+
+        size_t cells = shardCount / slabs + (slab < shardCount % slabs ? 1 : 0);
+        float cellLow = -infinity;
+        for (size_t cell = 0; cell < cells; ++cell) {
+            float cellHigh = cell + 1 == cells ? infinity : cut(slabItems, cellDim, cells, cell + 1, space.minCoords[cellDim], space.maxCoords[cellDim]);
+            vector<float> low(dimensions, -infinity), high(dimensions, infinity);
+            low[slabDim] = slabLow;
+            high[slabDim] = slabHigh;
+            if (cellDim != slabDim) {
+                low[cellDim] = cellLow;
+                high[cellDim] = cellHigh;
+            }
+            regions.emplace_back(low, high);
+            cellLow = cellHigh;
+        }
+        slabLow = slabHigh;
+    }
+    return regions;
+}
+
+// Shards that store the box: the one holding its center, or every region it touches
+template <typename Payload>
+vector<size_t> ShardedRStarTree<Payload>::route(const Rectangle& box) const {
+    vector<size_t> targets;
+    if (policy == DUPLICATE) {
+        for (size_t s = 0; s < shards.size(); ++s) {
+            if (shards[s]->region.overlapCheck(box))
+                targets.push_back(s);
+        }
+        return targets;
+    }
+
+    // Regions share their boundaries, so the first match wins
+    vector<float> center = box.getCenter();
+    for (size_t s = 0; s < shards.size(); ++s) {
+        if (shards[s]->region.overlapCheck(Rectangle(center, center))) {
+            targets.push_back(s);
+            break;
+        }
+    }
+    return targets;
+}
+
+template <typename Payload>
+void ShardedRStarTree<Payload>::insert(const Object<Payload>& object) {
+    for (size_t s : route(object)) {
+        lock_guard<mutex> guard(shards[s]->queueLock);
+        shards[s]->queue.push_back(object);
+        shards[s]->ready.notify_one();
+    }
+}
+
+// Routes the whole batch first, so each queue is locked once per call
+template <typename Payload>
+void ShardedRStarTree<Payload>::insert(const vector<Object<Payload>>& objects) {
+    vector<vector<Object<Payload>>> routed(shards.size());
+    for (const auto& object : objects) {
+        for (size_t s : route(object))
+            routed[s].push_back(object);
+    }
+
+    for (size_t s = 0; s < shards.size(); ++s) {
+        if (routed[s].empty()) continue;
+        lock_guard<mutex> guard(shards[s]->queueLock);
+        shards[s]->queue.insert(shards[s]->queue.end(), routed[s].begin(), routed[s].end());
+        shards[s]->ready.notify_one();
+    }
+}
+
+// Waits until every worker has applied its queue
+template <typename Payload>
+void ShardedRStarTree<Payload>::flush() {
+    for (auto& shard : shards) {
+        unique_lock<mutex> lock(shard->queueLock);
+        shard->drained.wait(lock, [&shard] { return shard->queue.empty() && !shard->busy; });
+    }
+}
+
+template <typename Payload>
+void ShardedRStarTree<Payload>::work(Shard& shard) {
+    unique_lock<mutex> lock(shard.queueLock);
+    while (true) {
+        shard.ready.wait(lock, [&shard] { return !shard.queue.empty() || shard.stopping; });
+        if (shard.queue.empty()) return;
+
+        vector<Object<Payload>> batch;
+        batch.swap(shard.queue);
+        shard.busy = true;
+        lock.unlock();
+
+        {
+            lock_guard<mutex> guard(shard.treeLock);
+            for (const auto& object : batch) {
+                shard.tree.insert(object);
+                shard.bounds = Rectangle::combine({shard.bounds, object});
+            }
+        }
+
+        lock.lock();
+        shard.busy = false;
+        shard.drained.notify_all();
+    }
+}
+
+template <typename Payload>
+vector<Object<Payload>> ShardedRStarTree<Payload>::rangeQuery(const Rectangle& query) {
+    vector<Object<Payload>> results;
+
+    for (size_t s = 0; s < shards.size(); ++s) {
+        Shard& shard = *shards[s];
+        lock_guard<mutex> guard(shard.treeLock);
+        if (!shard.bounds.overlapCheck(query)) continue;
+
+        for (auto& object : shard.tree.rangeQuery(query)) {
+            if (policy == DUPLICATE) {
+                // Report the object once, from the first shard holding it (which was queried, as its bounds hold the object)
+                size_t owner = 0;
+                while (!shards[owner]->region.overlapCheck(object))
+                    ++owner;
+                if (owner != s) continue;
+            }
+            results.push_back(move(object));
+        }
+    }
+    return results;
+}
+
+#endif // SHARDEDRSTARTREE_HPP
@@ -0,0 +1,225 @@
+#ifndef WORKLOADTRACE_HPP
+#define WORKLOADTRACE_HPP
+
+#include "RStarTree.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <chrono>
+
+/////////////////////
+// WorkloadTrace
+/////////////////////
+
+// Binary trace of the calls made against a tree, for deterministic replay (replay_main.cpp).
+// Layout: a header {"RSTW", version, dimensions, sizeof(Payload)}, then one record per call:
+//  - uint8 operation, with POINTS set when every box is a point (only min corners stored)
+//  - uint64 microseconds since recording started
+//  - uint32 number of objects
+//  - per object: the payload bytes (not for queries), the min corner, and the max corner
+// Payloads are written as raw bytes, so they must be trivially copyable.
+template <typename Payload = int64_t>
+struct TraceRecord {
+    enum Operation : uint8_t { INSERT = 1, BATCH_INSERT = 2, BULK_LOAD = 3, RANGE_QUERY = 4, POINTS = 0x80 };
+
+    Operation op;
+    uint64_t micros;
+    vector<Object<Payload>> objects; // The query window for RANGE_QUERY
+
+    static const char* name(Operation op);
+};
+
+template <typename Payload>
+const char* TraceRecord<Payload>::name(Operation op) {
+    switch (op) {
+        case INSERT: return "insert";
+        case BATCH_INSERT: return "batchInsert";
+        case BULK_LOAD: return "bulkLoad";
+        case RANGE_QUERY: return "rangeQuery";
+        default: return "unknown";
+    }
+}
+
+template <typename Payload = int64_t>
+class WorkloadTrace {
+    static_assert(is_trivially_copyable<Payload>::value, "Traced payloads must be trivially copyable");
+
+public:
+    static const uint32_t MAGIC = 0x57545352; // "RSTW"
+    static const uint32_t VERSION = 1;
+
+    int dimensions;
+    vector<TraceRecord<Payload>> records;
+
+    WorkloadTrace() : dimensions(0) {}
+    bool load(const string& path);
+};
+
+template <typename Payload>
+bool WorkloadTrace<Payload>::load(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        cerr << "Error: Could not open trace " << path << endl;
+        return false;
+    }
+
+    uint32_t header[4];
+    if (fread(header, sizeof(header), 1, file) != 1 || header[0] != MAGIC || header[1] != VERSION || header[3] != sizeof(Payload)) {
+        cerr << "Error: " << path << " is not a trace of this payload type" << endl;
+        fclose(file);
+        return false;
+    }
+    dimensions = static_cast<int>(header[2]);
+    records.clear();
+
+    vector<float> low(dimensions), high(dimensions);
+    uint8_t op;
+    while (fread(&op, sizeof(op), 1, file) == 1) {
+        TraceRecord<Payload> record;
+        uint32_t count;
+        bool points = op & TraceRecord<Payload>::POINTS;
+        record.op = static_cast<typename TraceRecord<Payload>::Operation>(op & ~TraceRecord<Payload>::POINTS);
+        if (fread(&record.micros, sizeof(record.micros), 1, file) != 1 || fread(&count, sizeof(count), 1, file) != 1)
+            break;
+
+        // A record cut short (the recorder was killed mid-write) ends the trace
+        bool complete = true;
+        // The count is unvalidated, so the reservation is capped and a damaged count only costs growth
+        record.objects.reserve(min<uint32_t>(count, 1u << 16));
+        for (uint32_t i = 0; i < count && complete; ++i) {
+            Payload payload = Payload();
+            if (record.op != TraceRecord<Payload>::RANGE_QUERY)
+                complete = fread(&payload, sizeof(Payload), 1, file) == 1;
+            complete = complete && fread(low.data(), sizeof(float), dimensions, file) == static_cast<size_t>(dimensions);
+            if (points)
+                high = low;
+            else
+                complete = complete && fread(high.data(), sizeof(float), dimensions, file) == static_cast<size_t>(dimensions);
+            if (complete) record.objects.emplace_back(payload, low, high);
+        }
+        if (!complete) break;
+        records.push_back(move(record));
+    }
+    fclose(file);
+    return true;
+}
+
+/////////////////////
+// RecordingRStarTree
+/////////////////////
+
+// Forwards insert, batchInsert, bulkLoad, and rangeQuery to the tree and appends each call,
+// with its arguments and time, to a WorkloadTrace file. Records are buffered and written in
+// large chunks; flush() (or the destructor) writes the rest.
+template <typename Payload = int64_t>
+class RecordingRStarTree {
+    static_assert(is_trivially_copyable<Payload>::value, "Traced payloads must be trivially copyable");
+
+public:
+    typedef TraceRecord<Payload> Record;
+
+    RStarTree<Payload> tree;
+    FILE* trace;
+    vector<char> pending;
+    chrono::steady_clock::time_point start;
+
+    RecordingRStarTree(const string& path, int maxEntries, int dimensions, bool pointData = false);
+    ~RecordingRStarTree();
+    void insert(const Object<Payload>& object);
+    void batchInsert(vector<Object<Payload>>& objects);
+    void bulkLoad(vector<Object<Payload>>& objects);
+    vector<Object<Payload>> rangeQuery(const Rectangle& query);
+    void flush();
+    template <typename Iterator>
+    void record(typename Record::Operation op, Iterator first, Iterator last);
+};
+
+template <typename Payload>
+RecordingRStarTree<Payload>::RecordingRStarTree(const string& path, int maxEntries, int dimensions, bool pointData)
+    : tree(maxEntries, dimensions, pointData), trace(fopen(path.c_str(), "wb")), start(chrono::steady_clock::now()) {
+    if (!trace) {
+        cerr << "Error: Could not create trace " << path << endl;
+        return;
+    }
+    uint32_t header[4] = {WorkloadTrace<Payload>::MAGIC, WorkloadTrace<Payload>::VERSION, static_cast<uint32_t>(dimensions), static_cast<uint32_t>(sizeof(Payload))};
+    fwrite(header, sizeof(header), 1, trace);
+}
+
+template <typename Payload>
+RecordingRStarTree<Payload>::~RecordingRStarTree() {
+    if (!trace) return;
+    flush();
+    fclose(trace);
+}
+
+template <typename Payload>
+void RecordingRStarTree<Payload>::insert(const Object<Payload>& object) {
+    record(Record::INSERT, &object, &object + 1);
+    tree.insert(object);
+}
+
+template <typename Payload>
+void RecordingRStarTree<Payload>::batchInsert(vector<Object<Payload>>& objects) {
+    record(Record::BATCH_INSERT, objects.begin(), objects.end());
+    tree.batchInsert(objects);
+}
+
+template <typename Payload>
+void RecordingRStarTree<Payload>::bulkLoad(vector<Object<Payload>>& objects) {
+    record(Record::BULK_LOAD, objects.begin(), objects.end());
+    tree.bulkLoad(objects);
+}
+
+template <typename Payload>
+vector<Object<Payload>> RecordingRStarTree<Payload>::rangeQuery(const Rectangle& query) {
+    Object<Payload> window(query, Payload());
+    record(Record::RANGE_QUERY, &window, &window + 1);
+    return tree.rangeQuery(query);
+}
+
+template <typename Payload>
+void RecordingRStarTree<Payload>::flush() {
+    if (!trace || pending.empty()) return;
+    fwrite(pending.data(), 1, pending.size(), trace);
+    fflush(trace);
+    pending.clear();
+}
+
+template <typename Payload>
+template <typename Iterator>
+void RecordingRStarTree<Payload>::record(typename Record::Operation op, Iterator first, Iterator last) {
+    if (!trace) return;
+
+    bool points = all_of(first, last, [](const Object<Payload>& object) { return object.minCoords == object.maxCoords; });
+    uint8_t code = op | (points ? Record::POINTS : 0);
+    uint64_t micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    uint32_t count = static_cast<uint32_t>(last - first);
+    size_t coordBytes = tree.dimensions * sizeof(float);
+    size_t objectBytes = (op == Record::RANGE_QUERY ? 0 : sizeof(Payload)) + (points ? 1 : 2) * coordBytes;
+
+    size_t offset = pending.size();
+    pending.resize(offset + sizeof(code) + sizeof(micros) + sizeof(count) + count * objectBytes);
+    char* out = pending.data() + offset;
+    memcpy(out, &code, sizeof(code));
+    memcpy(out + sizeof(code), &micros, sizeof(micros));
+    memcpy(out + sizeof(code) + sizeof(micros), &count, sizeof(count));
+    out += sizeof(code) + sizeof(micros) + sizeof(count);
+
+    for (Iterator it = first; it != last; ++it) {
+        if (op != Record::RANGE_QUERY) {
+            memcpy(out, &it->payload, sizeof(Payload));
+            out += sizeof(Payload);
+        }
+        memcpy(out, it->minCoords.data(), coordBytes);
+        out += coordBytes;
+        if (!points) {
+            memcpy(out, it->maxCoords.data(), coordBytes);
+            out += coordBytes;
+        }
+    }
+
+    if (pending.size() >= (1 << 20))
+        flush();
+}
+
+#endif // WORKLOADTRACE_HPP
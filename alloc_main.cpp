@@ -0,0 +1,126 @@
+/*
+=====================================================================
+R*-Tree Test: Allocation-free insertion
+=====================================================================
+
+What does it test?
+    Single insertions make no heap allocations unless they split a
+    node. Kept out of main.cpp, since counting allocations means
+    replacing the global operator new for the whole program.
+
+What does it do?
+    - Inserts the first half of the objects to warm the tree up.
+    - Moves the second half in one at a time, counting the heap
+      allocations of each insert and the nodes of the tree before and
+      after it.
+    - Fails if any insert that created no node allocated, or if the
+      tree does not hold every object afterwards.
+
+Command-line arguments:
+    - `-n` / `--numData`: Number of data points (default: 50000).
+    - `-c` / `--capacity`: Node capacity (default: 128).
+    - `-p` / `--points`: Store leaves as points instead of rectangles (default: off).
+=====================================================================
+ */
+
+#include "RStarTree.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <new>
+
+// Heap allocations made by the whole program
+static size_t heapAllocations = 0;
+
+// Kept out of line, so the compiler does not pair an inlined malloc() or free() with the other operator
+[[gnu::noinline]] void* operator new(size_t size) {
+    ++heapAllocations;
+    if (void* memory = malloc(size ? size : 1)) return memory;
+    throw bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* memory) noexcept { free(memory); }
+[[gnu::noinline]] void operator delete(void* memory, size_t) noexcept { free(memory); }
+
+void parseArguments(int argc, char* argv[], int& numData, int& capacity, bool& pointData) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-n" || arg == "--numData") {
+            if (i + 1 < argc) numData = atoi(argv[++i]);
+        } else if (arg == "-c" || arg == "--capacity") {
+            if (i + 1 < argc) capacity = atoi(argv[++i]);
+        } else if (arg == "-p" || arg == "--points") {
+            pointData = true;
+        } else {
+            cout << "Usage: " << argv[0] << " [options]\n";
+            cout << "Options:\n";
+            cout << "  -n, --numData <num>       Number of data points (default: 50000)\n";
+            cout << "  -c, --capacity <num>      Node capacity of the R*-Tree (default: 128)\n";
+            cout << "  -p, --points              Store leaves as points (default: off)\n";
+            exit(0);
+        }
+    }
+}
+
+// Walks the tree without allocating, so it can run between the counted inserts
+size_t countNodes(const RStarTree<>::Node* node) {
+    size_t nodes = 1;
+    if (!node->isLeaf) {
+        for (const auto* child : node->children)
+            nodes += countNodes(child);
+    }
+    return nodes;
+}
+
+int main(int argc, char* argv[]) {
+    int numData = 50000;
+    int capacity = 128;
+    bool pointData = false;
+
+    parseArguments(argc, argv, numData, capacity, pointData);
+
+    srand(0);
+    vector<Object<>> dataPoints;
+    for (int i = 0; i < numData; ++i) {
+        float x = static_cast<float>(rand() % 100001);
+        float y = static_cast<float>(rand() % 100001);
+        dataPoints.emplace_back(i, vector<float>{x, y}, vector<float>{x, y});
+    }
+
+    RStarTree<> tree(capacity, 2, pointData);
+    size_t half = dataPoints.size() / 2;
+    for (size_t i = 0; i < half; ++i)
+        tree.insert(dataPoints[i]);
+
+    size_t allocations = 0, splittingInserts = 0, allocatingInserts = 0, offenders = 0;
+    for (size_t i = half; i < dataPoints.size(); ++i) {
+        Object<> object = dataPoints[i];
+        size_t nodesBefore = countNodes(tree.root);
+        size_t before = heapAllocations;
+        tree.insert(move(object));
+        size_t made = heapAllocations - before;
+        bool split = countNodes(tree.root) != nodesBefore;
+
+        allocations += made;
+        splittingInserts += split;
+        allocatingInserts += made > 0;
+        if (made > 0 && !split) {
+            if (offenders++ < 5)
+                cout << "Insert " << i << " allocated " << made << " times without creating a node" << endl;
+        }
+    }
+
+    size_t objects = 0;
+    tree.forEachObject([&objects](const Rectangle&, const int64_t&) { ++objects; });
+    size_t inserts = dataPoints.size() - half;
+
+    cout << "Inserts: " << inserts << " | heap allocations: " << allocations
+         << " (" << static_cast<double>(allocations) / max<size_t>(inserts, 1) << " per insert)"
+         << " | inserts that allocated: " << allocatingInserts << " | inserts that created nodes: " << splittingInserts << endl;
+    if (objects != dataPoints.size())
+        cout << "Error: the tree holds " << objects << " of " << dataPoints.size() << " objects" << endl;
+
+    bool passed = offenders == 0 && objects == dataPoints.size();
+    cout << (passed ? "All inserts without splits were allocation-free!" : "Some inserts without splits did not stay allocation-free!") << endl;
+    cout << endl << "Test completed." << endl << endl;
+    return passed ? 0 : 1;
+}
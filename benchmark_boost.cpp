@@ -37,7 +37,7 @@ namespace bgi = boost::geometry::index;
 
 using BoostPoint = bg::model::point<float, 2, bg::cs::cartesian>;
 using BoostBox = bg::model::box<BoostPoint>;
-using BoostValue = std::pair<BoostBox, int>;  // box + id
+using BoostValue = std::pair<BoostBox, int64_t>;  // box + id
 using BoostRTree = bgi::rtree<BoostValue, bgi::rstar<128>>;  // R*-tree with capacity 128
 
 using namespace std::chrono;
@@ -50,11 +50,11 @@ struct BenchmarkResult {
 };
 
 // Generate random 2D points as rectangles (point = rectangle with same min/max)
-std::vector<Rectangle> generateRandomData(int numData, float minRange, float maxRange, unsigned seed) {
+std::vector<Object<>> generateRandomData(int numData, float minRange, float maxRange, unsigned seed) {
     std::mt19937 gen(seed);
     std::uniform_real_distribution<float> dist(minRange, maxRange);
     
-    std::vector<Rectangle> dataPoints;
+    std::vector<Object<>> dataPoints;
     dataPoints.reserve(numData);
     
     for (int i = 0; i < numData; ++i) {
@@ -76,7 +76,7 @@ std::vector<Rectangle> generateQueries(int numQueries, float minRange, float max
     for (int i = 0; i < numQueries; ++i) {
         float x = dist(gen);
         float y = dist(gen);
-        queries.emplace_back(i, 
+        queries.emplace_back(
             std::vector<float>{x, y}, 
             std::vector<float>{x + querySize, y + querySize});
     }
@@ -85,7 +85,7 @@ std::vector<Rectangle> generateQueries(int numQueries, float minRange, float max
 
 // ==================== Custom R*-Tree Benchmarks ====================
 
-double benchmarkCustomInsert(RStarTree& tree, const std::vector<Rectangle>& data) {
+double benchmarkCustomInsert(RStarTree<>& tree, const std::vector<Object<>>& data) {
     auto start = high_resolution_clock::now();
     for (const auto& rect : data) {
         tree.insert(rect);
@@ -94,14 +94,14 @@ double benchmarkCustomInsert(RStarTree& tree, const std::vector<Rectangle>& data
     return duration_cast<microseconds>(end - start).count() / 1000.0;
 }
 
-double benchmarkCustomBulkLoad(RStarTree& tree, std::vector<Rectangle> data) {
+double benchmarkCustomBulkLoad(RStarTree<>& tree, std::vector<Object<>> data) {
     auto start = high_resolution_clock::now();
     tree.bulkLoad(data);
     auto end = high_resolution_clock::now();
     return duration_cast<microseconds>(end - start).count() / 1000.0;
 }
 
-std::pair<double, size_t> benchmarkCustomQuery(RStarTree& tree, const std::vector<Rectangle>& queries) {
+std::pair<double, size_t> benchmarkCustomQuery(RStarTree<>& tree, const std::vector<Rectangle>& queries) {
     size_t totalResults = 0;
     auto start = high_resolution_clock::now();
     for (const auto& query : queries) {
@@ -114,20 +114,20 @@ std::pair<double, size_t> benchmarkCustomQuery(RStarTree& tree, const std::vecto
 
 // ==================== Boost R-tree Benchmarks ====================
 
-double benchmarkBoostInsert(BoostRTree& tree, const std::vector<Rectangle>& data) {
+double benchmarkBoostInsert(BoostRTree& tree, const std::vector<Object<>>& data) {
     auto start = high_resolution_clock::now();
     for (const auto& rect : data) {
         BoostBox box(
             BoostPoint(rect.minCoords[0], rect.minCoords[1]),
             BoostPoint(rect.maxCoords[0], rect.maxCoords[1])
         );
-        tree.insert(std::make_pair(box, rect.id));
+        tree.insert(std::make_pair(box, rect.payload));
     }
     auto end = high_resolution_clock::now();
     return duration_cast<microseconds>(end - start).count() / 1000.0;
 }
 
-double benchmarkBoostBulkLoad(const std::vector<Rectangle>& data) {
+double benchmarkBoostBulkLoad(const std::vector<Object<>>& data) {
     std::vector<BoostValue> values;
     values.reserve(data.size());
     
@@ -136,7 +136,7 @@ double benchmarkBoostBulkLoad(const std::vector<Rectangle>& data) {
             BoostPoint(rect.minCoords[0], rect.minCoords[1]),
             BoostPoint(rect.maxCoords[0], rect.maxCoords[1])
         );
-        values.emplace_back(box, rect.id);
+        values.emplace_back(box, rect.payload);
     }
     
     auto start = high_resolution_clock::now();
@@ -212,7 +212,7 @@ void runBenchmark(int numData, int numQueries, int capacity) {
     std::cout << "─────────────────────────────────────────────────────────────────────\n";
     
     // Single insertion benchmark
-    RStarTree customTree1(capacity, 2);
+    RStarTree<> customTree1(capacity, 2);
     double customInsertTime = benchmarkCustomInsert(customTree1, data);
     
     BoostRTree boostTree1;
@@ -232,7 +232,7 @@ void runBenchmark(int numData, int numQueries, int capacity) {
     std::cout << "─────────────────────────────────────────────────────────────────────\n";
     
     // Bulk load benchmark
-    RStarTree customTree2(capacity, 2);
+    RStarTree<> customTree2(capacity, 2);
     double customBulkTime = benchmarkCustomBulkLoad(customTree2, data);
     double boostBulkTime = benchmarkBoostBulkLoad(data);
     
@@ -248,7 +248,7 @@ void runBenchmark(int numData, int numQueries, int capacity) {
             BoostPoint(rect.minCoords[0], rect.minCoords[1]),
             BoostPoint(rect.maxCoords[0], rect.maxCoords[1])
         );
-        boostValues.emplace_back(box, rect.id);
+        boostValues.emplace_back(box, rect.payload);
     }
     BoostRTree boostTree2(boostValues.begin(), boostValues.end());
     auto [boostQueryTime2, boostResults2] = benchmarkBoostQuery(boostTree2, queries);
@@ -0,0 +1,293 @@
+/*
+=====================================================================
+R*-Tree Demo: Durability and crash recovery
+=====================================================================
+
+What does it test?
+    The write-ahead log and checkpoints of DurableRStarTree.
+
+What does it do?
+    - Runs a deterministic stream of inserts and removes in a child
+      process that is killed by crash injection at a random byte of
+      its log or checkpoint writes (torn writes included).
+    - Recovers the tree from disk in the parent and validates it
+      against the same stream replayed in memory: the recovered tree
+      must hold exactly a prefix of the stream that is at least as long
+      as the last group commit the child acknowledged.
+    - Measures recovery time.
+    - Damages the final checkpoint and checks that recovery refuses to
+      open the tree and leaves the log untouched.
+    - Reopens a store whose checkpoint is empty, and fails commits and
+      checkpoints on a full disk (a file size limit), checking that
+      nothing is acknowledged or lost.
+
+Command-line arguments:
+    - `-n` / `--numOps`: Operations per round (default: 20000).
+    - `-r` / `--rounds`: Crash-injection rounds (default: 20).
+    - `-g` / `--group`: Group commit size (default: 64).
+    - `-k` / `--checkpoint`: Operations between checkpoints (default: 5000).
+    - `-c` / `--capacity`: Node capacity (default: 128).
+    - `-f` / `--file`: Path prefix of the log and checkpoint files (default: /tmp/rstartree_durable).
+=====================================================================
+ */
+
+#include "DurableRStarTree.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <set>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <csignal>
+
+using namespace chrono;
+
+void parseArguments(int argc, char* argv[], int& numOps, int& rounds, int& groupSize, int& checkpointEvery, int& capacity, string& path) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-n" || arg == "--numOps") {
+            if (i + 1 < argc) numOps = atoi(argv[++i]);
+        } else if (arg == "-r" || arg == "--rounds") {
+            if (i + 1 < argc) rounds = atoi(argv[++i]);
+        } else if (arg == "-g" || arg == "--group") {
+            if (i + 1 < argc) groupSize = atoi(argv[++i]);
+        } else if (arg == "-k" || arg == "--checkpoint") {
+            if (i + 1 < argc) checkpointEvery = atoi(argv[++i]);
+        } else if (arg == "-c" || arg == "--capacity") {
+            if (i + 1 < argc) capacity = atoi(argv[++i]);
+        } else if (arg == "-f" || arg == "--file") {
+            if (i + 1 < argc) path = argv[++i];
+        } else {
+            cout << "Usage: " << argv[0] << " [options]\n";
+            cout << "Options:\n";
+            cout << "  -n, --numOps <num>        Operations per round (default: 20000)\n";
+            cout << "  -r, --rounds <num>        Crash-injection rounds (default: 20)\n";
+            cout << "  -g, --group <num>         Group commit size (default: 64)\n";
+            cout << "  -k, --checkpoint <num>    Operations between checkpoints (default: 5000)\n";
+            cout << "  -c, --capacity <num>      Node capacity of the R*-Tree (default: 128)\n";
+            cout << "  -f, --file <prefix>       Path prefix of the log and checkpoint files (default: /tmp/rstartree_durable)\n";
+            exit(0);
+        }
+    }
+}
+
+// Deterministic operation stream: mostly inserts of new points, every fifth operation removes a live one
+struct Operation {
+    bool insert;
+    Object<> object;
+};
+
+vector<Operation> generateOperations(int numOps, unsigned seed) {
+    mt19937 gen(seed);
+    uniform_real_distribution<float> coord(0.0F, 100000.0F);
+    vector<Operation> ops;
+    vector<Object<>> live;
+
+    for (int i = 0; i < numOps; ++i) {
+        if (i % 5 == 4 && !live.empty()) {
+            size_t victim = gen() % live.size();
+            ops.push_back({false, live[victim]});
+            live[victim] = live.back();
+            live.pop_back();
+        } else {
+            float x = coord(gen), y = coord(gen);
+            Object<> object(i, {x, y}, {x, y});
+            ops.push_back({true, object});
+            live.push_back(object);
+        }
+    }
+    return ops;
+}
+
+multiset<int64_t> expectedPayloads(const vector<Operation>& ops, uint64_t prefix) {
+    multiset<int64_t> payloads;
+    for (uint64_t i = 0; i < prefix; ++i) {
+        if (ops[i].insert)
+            payloads.insert(ops[i].object.payload);
+        else
+            payloads.erase(payloads.find(ops[i].object.payload));
+    }
+    return payloads;
+}
+
+multiset<int64_t> treePayloads(const RStarTree<>& tree) {
+    multiset<int64_t> payloads;
+    tree.forEachObject([&payloads](const Rectangle&, const int64_t& payload) { payloads.insert(payload); });
+    return payloads;
+}
+
+// Child process: apply the stream until the injected crash, reporting every acknowledged commit through the pipe
+void runUntilCrash(const vector<Operation>& ops, const string& path, int capacity, int groupSize, int checkpointEvery, long long crashAfterBytes, int pipeFd) {
+    DurableRStarTree<> durable(path, capacity, 2, false, groupSize);
+    durable.crashAfterBytes = crashAfterBytes;
+
+    for (size_t i = durable.lastLSN; i < ops.size(); ++i) {
+        if (ops[i].insert)
+            durable.insert(ops[i].object);
+        else
+            durable.remove(ops[i].object);
+
+        if ((i + 1) % checkpointEvery == 0)
+            durable.checkpoint();
+        if (durable.committedLSN == i + 1 && write(pipeFd, &durable.committedLSN, sizeof(uint64_t)) < 0)
+            _exit(2);
+    }
+    durable.commit();
+    if (write(pipeFd, &durable.committedLSN, sizeof(uint64_t)) < 0)
+        _exit(2);
+    _exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    int numOps = 20000;
+    int rounds = 20;
+    int groupSize = 64;
+    int checkpointEvery = 5000;
+    int capacity = 128;
+    string path = "/tmp/rstartree_durable";
+
+    parseArguments(argc, argv, numOps, rounds, groupSize, checkpointEvery, capacity, path);
+
+    vector<Operation> ops = generateOperations(numOps, 42);
+    mt19937 gen(7);
+    bool allRoundsMatched = true;
+
+    remove((path + ".log").c_str());
+    remove((path + ".ckpt").c_str());
+
+    // Each round resumes from what the previous crash left on disk
+    for (int round = 0; round < rounds; ++round) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            cerr << "Error: Could not create pipe" << endl;
+            return 1;
+        }
+
+        long long crashAfterBytes = gen() % (numOps * 40 / rounds + 1);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            runUntilCrash(ops, path, capacity, groupSize, checkpointEvery, crashAfterBytes, fds[1]);
+        }
+        close(fds[1]);
+
+        uint64_t acknowledged = 0, value;
+        while (read(fds[0], &value, sizeof(value)) == sizeof(value))
+            acknowledged = value;
+        close(fds[0]);
+        int status;
+        waitpid(pid, &status, 0);
+
+        auto start = high_resolution_clock::now();
+        DurableRStarTree<> recovered(path, capacity, 2, false, groupSize);
+        auto duration = duration_cast<microseconds>(high_resolution_clock::now() - start);
+
+        bool matched = recovered.isOpen() && recovered.lastLSN >= acknowledged && recovered.lastLSN <= ops.size()
+            && treePayloads(recovered.tree) == expectedPayloads(ops, recovered.lastLSN);
+        allRoundsMatched = allRoundsMatched && matched;
+
+        cout << "Round " << round << ": crash after " << crashAfterBytes << " bytes"
+             << " | acknowledged: " << acknowledged << " | recovered: " << recovered.lastLSN
+             << " | recovery time: " << duration.count() / 1000.0 << " ms"
+             << (matched ? "" : " | MISMATCH") << endl;
+
+        if (recovered.lastLSN == ops.size()) break;
+    }
+
+    // A damaged checkpoint must keep the tree closed and leave the log untouched
+    {
+        DurableRStarTree<> durable(path, capacity, 2, false, groupSize);
+        durable.checkpoint();
+        durable.insert(ops[0].object);
+    }
+    FILE* checkpoint = fopen((path + ".ckpt").c_str(), "r+b");
+    if (checkpoint) {
+        fseek(checkpoint, 24, SEEK_SET);
+        int byte = fgetc(checkpoint);
+        fseek(checkpoint, 24, SEEK_SET);
+        fputc(byte ^ 0xFF, checkpoint);
+        fclose(checkpoint);
+    }
+    struct stat before, after;
+    stat((path + ".log").c_str(), &before);
+    {
+        DurableRStarTree<> damaged(path, capacity, 2, false, groupSize);
+        stat((path + ".log").c_str(), &after);
+        bool refused = checkpoint && !damaged.isOpen() && before.st_size == after.st_size && before.st_size > 0;
+        cout << "Damaged checkpoint: " << (refused ? "refused to open, log untouched" : "MISMATCH") << endl;
+        allRoundsMatched = allRoundsMatched && refused;
+    }
+
+    // Removing every object leaves an empty checkpoint, which must reopen as an empty tree
+    string emptyPath = path + ".empty";
+    remove((emptyPath + ".log").c_str());
+    remove((emptyPath + ".ckpt").c_str());
+    {
+        DurableRStarTree<> durable(emptyPath, capacity, 2, false, groupSize);
+        durable.insert(ops[0].object);
+        durable.remove(ops[0].object);
+        durable.checkpoint();
+    }
+    {
+        DurableRStarTree<> reopened(emptyPath, capacity, 2, false, groupSize);
+        bool matched = reopened.isOpen() && reopened.lastLSN == 2 && treePayloads(reopened.tree).empty();
+        cout << "Empty checkpoint: " << (matched ? "reopened empty" : "MISMATCH") << endl;
+        allRoundsMatched = allRoundsMatched && matched;
+    }
+
+    // A full disk (a file size limit here) must fail checkpoints and commits without acknowledging
+    // anything or losing what is on disk, and a later commit must write the held-back records
+    string fullPath = path + ".full";
+    remove((fullPath + ".log").c_str());
+    remove((fullPath + ".ckpt").c_str());
+    {
+        size_t first = ops.size() / 4, second = ops.size() / 2;
+        DurableRStarTree<> durable(fullPath, capacity, 2, false, groupSize);
+        bool matched = true;
+        for (size_t i = 0; i < second; ++i) {
+            if (ops[i].insert)
+                durable.insert(ops[i].object);
+            else
+                durable.remove(ops[i].object);
+            if (i + 1 == first)
+                matched = durable.checkpoint();
+        }
+        matched = matched && durable.commit();
+
+        struct stat checkpointBefore, logBefore, checkpointAfter, logAfter;
+        stat((fullPath + ".ckpt").c_str(), &checkpointBefore);
+        stat((fullPath + ".log").c_str(), &logBefore);
+        uint64_t acknowledged = durable.committedLSN;
+
+        // Both files are past the limit, so every further write fails
+        signal(SIGXFSZ, SIG_IGN);
+        struct rlimit limit, full;
+        getrlimit(RLIMIT_FSIZE, &limit);
+        full = limit;
+        full.rlim_cur = 64;
+        setrlimit(RLIMIT_FSIZE, &full);
+        matched = matched && !durable.checkpoint();
+        if (ops[second].insert)
+            durable.insert(ops[second].object);
+        else
+            durable.remove(ops[second].object);
+        matched = matched && !durable.commit() && durable.committedLSN == acknowledged;
+        setrlimit(RLIMIT_FSIZE, &limit);
+
+        stat((fullPath + ".ckpt").c_str(), &checkpointAfter);
+        stat((fullPath + ".log").c_str(), &logAfter);
+        matched = matched && checkpointAfter.st_size == checkpointBefore.st_size && logAfter.st_size == logBefore.st_size
+            && access((fullPath + ".ckpt.tmp").c_str(), F_OK) != 0 && durable.commit();
+
+        DurableRStarTree<> reopened(fullPath, capacity, 2, false, groupSize);
+        matched = matched && reopened.lastLSN == second + 1 && treePayloads(reopened.tree) == expectedPayloads(ops, second + 1);
+        cout << "Full disk: " << (matched ? "nothing acknowledged or lost" : "MISMATCH") << endl;
+        allRoundsMatched = allRoundsMatched && matched;
+    }
+
+    cout << (allRoundsMatched ? "All recoveries matched!" : "Some recoveries did not match!") << endl;
+    cout << endl << "Benchmark completed." << endl << endl;
+    return allRoundsMatched ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+/*
+=====================================================================
+R*-Tree Demo: Out-of-core bulk loading
+=====================================================================
+
+What does it test?
+    ExternalSTRBuilder: STR bulk loading of inputs larger than the
+    memory budget into an index file, queried through MappedRStarTree.
+
+What does it do?
+    - Generates a binary input file of random objects (or reads the
+      given binary or .stream file).
+    - Builds the index once per memory budget and reports the build
+      throughput, sorted runs, k-way merges, and temporary bytes.
+    - Validates range queries on the mapped index against a linear
+      scan, and compares with an in-memory bulkLoad (with -v).
+    - Builds an index from an empty input file (with -v).
+
+Command-line arguments:
+    - `-n` / `--numData`: Number of generated objects (default: 2000000).
+    - `-q` / `--numQueries`: Number of queries (default: 1000).
+    - `-c` / `--capacity`: Node capacity (default: 128).
+    - `-m` / `--memory`: Comma-separated memory budgets in MB (default: 2,8,32,128).
+    - `-i` / `--input`: Binary or .stream input file (default: generated).
+    - `-o` / `--output`: Index file to write (default: external.idx).
+    - `-t` / `--temp`: Directory for the sorted runs (default: /tmp).
+    - `-p` / `--points`: Store leaves as points instead of rectangles (default: off).
+    - `-v` / `--validate`: Validate query results (default: off).
+=====================================================================
+ */
+
+#include "ExternalSTR.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+
+using namespace chrono;
+
+struct ExternalOptions {
+    int numData = 2000000;
+    int numQueries = 1000;
+    int capacity = 128;
+    string budgets = "2,8,32,128";
+    string input;
+    string output = "external.idx";
+    string tempDir = "/tmp";
+    bool pointData = false;
+    bool validateResults = false;
+};
+
+void parseArguments(int argc, char* argv[], ExternalOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-n" || arg == "--numData") {
+            if (i + 1 < argc) options.numData = atoi(argv[++i]);
+        } else if (arg == "-q" || arg == "--numQueries") {
+            if (i + 1 < argc) options.numQueries = atoi(argv[++i]);
+        } else if (arg == "-c" || arg == "--capacity") {
+            if (i + 1 < argc) options.capacity = atoi(argv[++i]);
+        } else if (arg == "-m" || arg == "--memory") {
+            if (i + 1 < argc) options.budgets = argv[++i];
+        } else if (arg == "-i" || arg == "--input") {
+            if (i + 1 < argc) options.input = argv[++i];
+        } else if (arg == "-o" || arg == "--output") {
+            if (i + 1 < argc) options.output = argv[++i];
+        } else if (arg == "-t" || arg == "--temp") {
+            if (i + 1 < argc) options.tempDir = argv[++i];
+        } else if (arg == "-p" || arg == "--points") {
+            options.pointData = true;
+        } else if (arg == "-v" || arg == "--validate") {
+            options.validateResults = true;
+        } else {
+            cout << "Usage: " << argv[0] << " [options]\n";
+            cout << "Options:\n";
+            cout << "  -n, --numData <num>       Number of generated objects (default: 2000000)\n";
+            cout << "  -q, --numQueries <num>    Number of range queries to perform (default: 1000)\n";
+            cout << "  -c, --capacity <num>      Node capacity of the R*-Tree (default: 128)\n";
+            cout << "  -m, --memory <list>       Comma-separated memory budgets in MB (default: 2,8,32,128)\n";
+            cout << "  -i, --input <file>        Binary or .stream input file (default: generated)\n";
+            cout << "  -o, --output <file>       Index file to write (default: external.idx)\n";
+            cout << "  -t, --temp <dir>          Directory for the sorted runs (default: /tmp)\n";
+            cout << "  -p, --points              Store leaves as points instead of rectangles (default: off)\n";
+            cout << "  -v, --validate            Enable brute-force validation (default: off)\n";
+            exit(0);
+        }
+    }
+}
+
+// Writes random points (small boxes unless -p) as binary records {id, min corner, max corner}
+void generateInput(const string& path, int numData, bool pointData) {
+    mt19937 gen(42);
+    uniform_real_distribution<float> coord(0.0F, 100000.0F);
+    uniform_real_distribution<float> size(0.0F, pointData ? 0.0F : 10.0F);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        cerr << "Error: Could not create " << path << endl;
+        exit(1);
+    }
+    for (int64_t i = 0; i < numData; ++i) {
+        float x = coord(gen), y = coord(gen);
+        float box[4] = {x, y, x + size(gen), y + size(gen)};
+        fwrite(&i, sizeof(i), 1, file);
+        fwrite(box, sizeof(float), 4, file);
+    }
+    fclose(file);
+}
+
+vector<Object<>> readInput(const string& path) {
+    vector<Object<>> objects;
+    if (path.size() >= 7 && path.compare(path.size() - 7, 7, ".stream") == 0) {
+        ifstream file(path);
+        string line;
+        while (getline(file, line)) {
+            istringstream row(line);
+            char type;
+            int64_t id;
+            long x, y;
+            if ((row >> type >> id >> x >> y) && type == 'E')
+                objects.emplace_back(id, vector<float>{static_cast<float>(x), static_cast<float>(y)}, vector<float>{static_cast<float>(x), static_cast<float>(y)});
+        }
+        return objects;
+    }
+
+    FILE* file = fopen(path.c_str(), "rb");
+    int64_t id;
+    float box[4];
+    while (file && fread(&id, sizeof(id), 1, file) == 1 && fread(box, sizeof(float), 4, file) == 4)
+        objects.emplace_back(id, vector<float>{box[0], box[1]}, vector<float>{box[2], box[3]});
+    if (file) fclose(file);
+    return objects;
+}
+
+// Compares the ids found by the mapped index with a linear scan
+bool validate(const MappedRStarTree<>& index, const vector<Object<>>& objects, const vector<Rectangle>& queries) {
+    for (const auto& query : queries) {
+        vector<int64_t> found, expected;
+        for (const auto& object : index.rangeQuery(query))
+            found.push_back(object.payload);
+        for (const auto& object : objects)
+            if (query.overlapCheck(object)) expected.push_back(object.payload);
+        sort(found.begin(), found.end());
+        sort(expected.begin(), expected.end());
+        if (found != expected) {
+            cout << "Query results: " << found.size() << " | linear scan results: " << expected.size() << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Builds an index from an empty input file, which must map as a single empty leaf
+bool checkEmptyInput(const ExternalOptions& options, const vector<Rectangle>& queries) {
+    string input = options.output + ".empty";
+    generateInput(input, 0, options.pointData);
+    ExternalSTRBuilder<> builder(options.capacity, 2, options.pointData, 1 << 20, options.tempDir);
+    bool built = builder.build(input, options.output);
+    remove(input.c_str());
+    if (!built) return false;
+
+    MappedRStarTree<> index(options.output);
+    bool matched = index.isOpen() && index.header.objects == 0 && index.header.height == 1;
+    for (size_t i = 0; i < queries.size() && matched; ++i)
+        matched = index.rangeQuery(queries[i]).empty();
+    cout << "Empty input: " << (matched ? "built a single empty leaf" : "MISMATCH") << endl << endl;
+    return matched;
+}
+
+int main(int argc, char* argv[]) {
+    ExternalOptions options;
+    parseArguments(argc, argv, options);
+
+    string input = options.input;
+    if (input.empty()) {
+        input = options.output + ".input";
+        generateInput(input, options.numData, options.pointData);
+    }
+
+    vector<Rectangle> queries;
+    mt19937 gen(7);
+    uniform_real_distribution<float> corner(0.0F, 100000.0F), side(1.0F, 1000.0F);
+    for (int i = 0; i < options.numQueries; ++i) {
+        float x = corner(gen), y = corner(gen);
+        queries.emplace_back(vector<float>{x, y}, vector<float>{x + side(gen), y + side(gen)});
+    }
+
+    vector<Object<>> objects;
+    if (options.validateResults) {
+        objects = readInput(input);
+        vector<Object<>> copy = objects;
+        RStarTree<> tree(options.capacity, 2, options.pointData);
+        auto start = high_resolution_clock::now();
+        tree.bulkLoad(copy);
+        double loadTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+        cout << "In-memory bulkLoad time: " << loadTime << " s (" << objects.size() << " objects, held in memory)" << endl << endl;
+    }
+
+    bool allQueriesMatch = !options.validateResults || checkEmptyInput(options, queries);
+    stringstream budgets(options.budgets);
+    for (string budget; getline(budgets, budget, ',');) {
+        double budgetMB = atof(budget.c_str());
+        ExternalSTRBuilder<> builder(options.capacity, 2, options.pointData, static_cast<size_t>(budgetMB * (1 << 20)), options.tempDir);
+
+        auto start = high_resolution_clock::now();
+        if (!builder.build(input, options.output)) return 1;
+        double buildTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+        double inputMB = builder.objects * builder.recordBytes() / 1048576.0;
+
+        cout << "Memory budget: " << budgetMB << " MB (input " << inputMB / budgetMB << "x the budget)"
+             << " | build time: " << buildTime << " s"
+             << " | throughput: " << builder.objects / buildTime << " objects/s, " << inputMB / buildTime << " MB/s" << endl;
+        cout << "   Sorted runs: " << builder.runs << " | k-way merges: " << builder.merges
+             << " | temporary MB written: " << builder.tempBytes / 1048576.0 << " | nodes: " << builder.nodes << endl;
+
+        MappedRStarTree<> index(options.output);
+        if (!index.isOpen()) return 1;
+        start = high_resolution_clock::now();
+        size_t results = 0;
+        for (const auto& query : queries)
+            results += index.rangeQuery(query).size();
+        double queryTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+        cout << "   Height: " << index.header.height << " | query time: " << queryTime << " s (" << results << " results)" << endl;
+
+        if (options.validateResults)
+            allQueriesMatch = validate(index, objects, queries) && allQueriesMatch;
+    }
+
+    if (options.validateResults)
+        cout << (allQueriesMatch ? "All queries matched!" : "Some queries did not match!") << endl;
+    cout << endl << "Benchmark completed." << endl << endl;
+    return allQueriesMatch ? 0 : 1;
+}
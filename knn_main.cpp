@@ -0,0 +1,175 @@
+/*
+=====================================================================
+R*-Tree Demo: k-nearest-neighbor join
+=====================================================================
+
+What does it test?
+    knnJoin: the k nearest stations of every event, by simultaneous
+    traversal of the event tree and the station tree.
+
+What does it do?
+    - Bulk loads clustered events and uniform stations into two trees.
+    - Joins them with 1, 2, 4, ... worker threads (up to the limit) and
+      reports the join time and speedup.
+    - Validates the neighbor distances of every event against a
+      linear scan over the stations, for every thread count.
+
+Command-line arguments:
+    - `-n` / `--numEvents`: Number of events, the outer set (default: 100000).
+    - `-m` / `--numStations`: Number of stations, the inner set (default: 10000).
+    - `-k` / `--neighbors`: Neighbors per event (default: 5).
+    - `-c` / `--capacity`: Node capacity (default: 128).
+    - `-t` / `--threads`: Largest thread count (default: hardware threads).
+    - `-p` / `--points`: Store leaves as points instead of rectangles (default: off).
+    - `-v` / `--validate`: Validate the join against a linear scan (default: off).
+=====================================================================
+ */
+
+#include "KnnJoin.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <mutex>
+
+using namespace chrono;
+
+void parseArguments(int argc, char* argv[], int& numEvents, int& numStations, int& k, int& capacity, int& maxThreads, bool& pointData, bool& validateResults) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-n" || arg == "--numEvents") {
+            if (i + 1 < argc) numEvents = atoi(argv[++i]);
+        } else if (arg == "-m" || arg == "--numStations") {
+            if (i + 1 < argc) numStations = atoi(argv[++i]);
+        } else if (arg == "-k" || arg == "--neighbors") {
+            if (i + 1 < argc) k = atoi(argv[++i]);
+        } else if (arg == "-c" || arg == "--capacity") {
+            if (i + 1 < argc) capacity = atoi(argv[++i]);
+        } else if (arg == "-t" || arg == "--threads") {
+            if (i + 1 < argc) maxThreads = atoi(argv[++i]);
+        } else if (arg == "-p" || arg == "--points") {
+            pointData = true;
+        } else if (arg == "-v" || arg == "--validate") {
+            validateResults = true;
+        } else {
+            cout << "Usage: " << argv[0] << " [options]\n";
+            cout << "Options:\n";
+            cout << "  -n, --numEvents <num>     Number of events, the outer set (default: 100000)\n";
+            cout << "  -m, --numStations <num>   Number of stations, the inner set (default: 10000)\n";
+            cout << "  -k, --neighbors <num>     Neighbors per event (default: 5)\n";
+            cout << "  -c, --capacity <num>      Node capacity of the R*-Tree (default: 128)\n";
+            cout << "  -t, --threads <num>       Largest thread count (default: hardware threads)\n";
+            cout << "  -p, --points              Store leaves as points instead of rectangles (default: off)\n";
+            cout << "  -v, --validate            Enable brute-force validation (default: off)\n";
+            exit(0);
+        }
+    }
+}
+
+// Events cluster around a few hot spots, with small extents unless they are points
+vector<Object<>> generateEvents(int numEvents, bool pointData, mt19937& gen) {
+    uniform_real_distribution<float> uniform(0.0F, 100000.0F);
+    uniform_real_distribution<float> size(0.0F, pointData ? 0.0F : 50.0F);
+    normal_distribution<float> spread(0.0F, 3000.0F);
+    vector<pair<float, float>> hotSpots;
+    for (int i = 0; i < 10; ++i)
+        hotSpots.push_back({uniform(gen), uniform(gen)});
+
+    vector<Object<>> events;
+    for (int i = 0; i < numEvents; ++i) {
+        const auto& spot = hotSpots[gen() % hotSpots.size()];
+        float x = spot.first + spread(gen), y = spot.second + spread(gen);
+        events.emplace_back(i, vector<float>{x, y}, vector<float>{x + size(gen), y + size(gen)});
+    }
+    return events;
+}
+
+vector<Object<>> generateStations(int numStations, mt19937& gen) {
+    uniform_real_distribution<float> uniform(0.0F, 100000.0F);
+    vector<Object<>> stations;
+    for (int i = 0; i < numStations; ++i) {
+        float x = uniform(gen), y = uniform(gen);
+        stations.emplace_back(i, vector<float>{x, y}, vector<float>{x, y});
+    }
+    return stations;
+}
+
+// Compares distances rather than ids, since equally distant stations may come in any order
+bool validate(const vector<Object<>>& events, const vector<Object<>>& stations, size_t k, const vector<vector<float>>& joined) {
+    vector<float> distances(stations.size());
+    for (const auto& event : events) {
+        for (size_t s = 0; s < stations.size(); ++s)
+            distances[s] = sqrt(event.minDistSq(stations[s]));
+        size_t count = min(k, distances.size());
+        partial_sort(distances.begin(), distances.begin() + count, distances.end());
+
+        const vector<float>& found = joined[event.payload];
+        if (found.size() != count) {
+            cout << "Event " << event.payload << ": " << found.size() << " neighbors instead of " << count << endl;
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (fabs(found[i] - distances[i]) > 1e-3F * max(1.0F, distances[i])) {
+                cout << "Event " << event.payload << ": neighbor " << i << " at " << found[i] << " instead of " << distances[i] << endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int numEvents = 100000;
+    int numStations = 10000;
+    int k = 5;
+    int capacity = 128;
+    int maxThreads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    bool pointData = false;
+    bool validateResults = false;
+
+    parseArguments(argc, argv, numEvents, numStations, k, capacity, maxThreads, pointData, validateResults);
+
+    mt19937 gen(42);
+    vector<Object<>> events = generateEvents(numEvents, pointData, gen);
+    vector<Object<>> stations = generateStations(numStations, gen);
+    vector<Object<>> eventsCopy = events, stationsCopy = stations;
+    RStarTree<> eventTree(capacity, 2, pointData), stationTree(capacity, 2, pointData);
+    eventTree.bulkLoad(eventsCopy);
+    stationTree.bulkLoad(stationsCopy);
+    cout << "Events: " << numEvents << " | stations: " << numStations << " | k: " << k << endl << endl;
+
+    double singleThreadTime = 0.0;
+    bool allJoinsMatch = true;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        vector<vector<float>> joined(numEvents);
+        mutex joinedLock;
+        size_t pairs = 0;
+
+        auto start = high_resolution_clock::now();
+        knnJoin(eventTree, stationTree, k, [&](const Object<>& event, const vector<Neighbor<>>& neighbors) {
+            vector<float> distances;
+            for (const auto& neighbor : neighbors)
+                distances.push_back(neighbor.distance);
+            lock_guard<mutex> guard(joinedLock);
+            pairs += neighbors.size();
+            joined[event.payload] = move(distances);
+        }, threads);
+        double joinTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+        if (threads == 1) singleThreadTime = joinTime;
+
+        cout << "Threads: " << threads << " | join time: " << joinTime << " s (speedup " << singleThreadTime / joinTime << "x)"
+             << " | pairs: " << pairs << endl;
+
+        if (validateResults) {
+            start = high_resolution_clock::now();
+            allJoinsMatch = validate(events, stations, k, joined) && allJoinsMatch;
+            double scanTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+            cout << "Linear scan time: " << scanTime << " s" << endl;
+        }
+    }
+
+    if (validateResults)
+        cout << (allJoinsMatch ? "All neighbors matched!" : "Some neighbors did not match!") << endl;
+    cout << endl << "Benchmark completed." << endl << endl;
+    return allJoinsMatch ? 0 : 1;
+}
@@ -8,6 +8,21 @@ What does it test?
     1. Bulk Loading.
     2. Single Insertions.
     3. Batch Insertions.
+    4. Buffered Insertions.
+    5. Bulk Loading from columnar arrays.
+    6. Predicate queries (within, contains point, distance, and their AND).
+    7. Paginated queries through a cursor.
+    8. Range queries through the prefetching breadth-first traversal.
+    9. Range queries on compact breadth-first and van Emde Boas replicas.
+    10. Batched range queries over a grid of adjacent tiles.
+    11. Online repacking of a dynamically built tree.
+    12. Moving objects through bottom-up updates.
+    13. Uniform sampling within windows of growing size.
+    14. Range queries on compressed leaves.
+    15. Workload recording for replay_main.cpp (with -r).
+    16. Top-k queries by score on a tree built with scores enabled.
+    17. Regional purges with removeRange versus one remove per object.
+    18. Empty input to every loading method.
 
 What does it do?
     - Validates range queries results against a linear scan.
@@ -19,20 +34,38 @@ Command-line arguments:
     - `-q` / `--numQueries`: Number of queries (default: 1000).
     - `-d` / `--dimension`: Data dimensionality (default: 2).
     - `-c` / `--capacity`: Node capacity (default: 128).
+    - `-b` / `--buffer`: Delta buffer size for buffered insertions (default: 4096).
+    - `-p` / `--points`: Store leaves as points instead of rectangles (default: off).
+    - `-o` / `--optimize`: Objects re-packed per optimize call (default: 10000).
+    - `-a` / `--analyze`: Print tree quality per level as text, csv, or json (default: off).
     - `-v` / `--validate`: Validate query results (default: off).
+    - `-r` / `--record`: Record a mixed workload to this trace file (default: off).
 =====================================================================
  */
 
 #include "RStarTree.hpp"
+#include "WorkloadTrace.hpp"
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
 #include <chrono>
 #include <set>
+#include <random>
 
 using namespace chrono;
 
-void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int& dimension, int& capacity, bool& validateResults) {
+// Compile checks: every member must build for payloads without a std::hash, which have no update index
+struct Meta {
+    int32_t id;
+    float weight;
+};
+
+inline bool operator==(const Meta& a, const Meta& b) { return a.id == b.id && a.weight == b.weight; }
+
+template class RStarTree<NoPayload>;
+template class RStarTree<Meta>;
+
+void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int& dimension, int& capacity, int& bufferSize, bool& pointData, int& optimizeBudget, string& analysis, bool& validateResults, string& recordFile) {
     for (int i = 1; i < argc; ++i) {
         string arg = argv[i];
         if (arg == "-n" || arg == "--numData") {
@@ -43,8 +76,18 @@ void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int&
             if (i + 1 < argc) dimension = atoi(argv[++i]);
         } else if (arg == "-c" || arg == "--capacity") {
             if (i + 1 < argc) capacity = atoi(argv[++i]);
+        } else if (arg == "-b" || arg == "--buffer") {
+            if (i + 1 < argc) bufferSize = atoi(argv[++i]);
+        } else if (arg == "-p" || arg == "--points") {
+            pointData = true;
+        } else if (arg == "-o" || arg == "--optimize") {
+            if (i + 1 < argc) optimizeBudget = atoi(argv[++i]);
+        } else if (arg == "-a" || arg == "--analyze") {
+            if (i + 1 < argc) analysis = argv[++i];
         } else if (arg == "-v" || arg == "--validate") {
             validateResults = true;
+        } else if (arg == "-r" || arg == "--record") {
+            if (i + 1 < argc) recordFile = argv[++i];
         } else {
             cout << "Usage: " << argv[0] << " [options]\n";
             cout << "Options:\n";
@@ -52,24 +95,29 @@ void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int&
             cout << "  -q, --numQueries <num>    Number of range queries to perform (default: 1000)\n";
             cout << "  -d, --dimension <num>     Dimensionality of the data (default: 2)\n";
             cout << "  -c, --capacity <num>      Node capacity of the R*-Tree (default: 128)\n";
+            cout << "  -b, --buffer <num>        Delta buffer size for buffered insertions (default: 4096)\n";
+            cout << "  -p, --points              Store leaves as points instead of rectangles (default: off)\n";
+            cout << "  -o, --optimize <num>      Objects re-packed per optimize call (default: 10000)\n";
+            cout << "  -a, --analyze <format>    Print tree quality per level as text, csv, or json (default: off)\n";
             cout << "  -v, --validate            Enable brute-force validation (default: off)\n";
+            cout << "  -r, --record <file>       Record a mixed workload to a trace file (default: off)\n";
             exit(0);
         } 
     }
 }
 
-vector<Rectangle> generateRandomData(int numData, int minRange, int maxRange) {
-    vector<Rectangle> dataPoints;
+vector<Object<>> generateRandomData(int numData, int minRange, int maxRange) {
+    vector<Object<>> dataPoints;
     for (int i = 0; i < numData; ++i) {
         float x1 = static_cast<float>(minRange + rand() % (maxRange - minRange + 1));
         float y1 = static_cast<float>(minRange + rand() % (maxRange - minRange + 1));
-        Rectangle rect(i, {x1, y1}, {x1, y1});
+        Object<> rect(i, {x1, y1}, {x1, y1});
         dataPoints.push_back(rect);
     }
     return dataPoints;
 }
 
-void insert(RStarTree& tree, const vector<Rectangle>& dataPoints) {
+void insert(RStarTree<>& tree, const vector<Object<>>& dataPoints) {
     auto start = high_resolution_clock::now();
     for (const auto& rect : dataPoints)
         tree.insert(rect);
@@ -77,22 +125,199 @@ void insert(RStarTree& tree, const vector<Rectangle>& dataPoints) {
     cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
 }
 
-void insertBatches(RStarTree& tree, vector<Rectangle>& dataPoints, int capacity) {
+void insertBatches(RStarTree<>& tree, vector<Object<>>& dataPoints, int capacity) {
     auto start = high_resolution_clock::now();
     tree.batchInsert(dataPoints);
     auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
     cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
 }
 
-void insertBulkLoad(RStarTree& tree, vector<Rectangle>& dataPoints) {
+void insertBulkLoad(RStarTree<>& tree, vector<Object<>>& dataPoints) {
     auto start = high_resolution_clock::now();
     tree.bulkLoad(dataPoints); 
     auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
     cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
 }
 
-vector<Rectangle> linearScanQuery(const vector<Rectangle>& points, const Rectangle& query) {
-    vector<Rectangle> results;
+void insertColumnar(RStarTree<>& tree, const vector<Object<>>& dataPoints) {
+    // Columnar copy of the data, as delivered by an ingest pipeline
+    vector<vector<float>> columns(tree.dimensions, vector<float>(dataPoints.size()));
+    vector<int64_t> ids(dataPoints.size());
+    for (size_t i = 0; i < dataPoints.size(); ++i) {
+        for (int d = 0; d < tree.dimensions; ++d)
+            columns[d][i] = dataPoints[i].minCoords[d];
+        ids[i] = dataPoints[i].payload;
+    }
+    vector<const float*> columnPointers;
+    for (const auto& column : columns)
+        columnPointers.push_back(column.data());
+
+    auto start = high_resolution_clock::now();
+    tree.bulkLoad(columnPointers, ids.data(), ids.size());
+    auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
+}
+
+// Every loading path must accept no objects and leave an empty tree that still takes inserts
+void checkEmptyInput(int capacity, int dimension, bool pointData, bool validateResults) {
+    vector<Object<>> none;
+    vector<const float*> columns(dimension, nullptr);
+    Rectangle everything(vector<float>(dimension, -1e9F), vector<float>(dimension, 1e9F));
+    mt19937 gen(0);
+
+    RStarTree<> bulk(capacity, dimension, pointData), columnar(capacity, dimension, pointData), batch(capacity, dimension, pointData);
+    bulk.bulkLoad(none);
+    columnar.bulkLoad(columns, nullptr, 0);
+    batch.batchInsert(none);
+
+    bool empty = true;
+    for (RStarTree<>* tree : {&bulk, &columnar, &batch}) {
+        empty = empty && tree->rangeQuery(everything).empty() && tree->sample(everything, 10, gen).empty();
+        tree->insert(Object<>(0, vector<float>(dimension, 1.0F), vector<float>(dimension, 1.0F)));
+        empty = empty && tree->rangeQuery(everything).size() == 1;
+    }
+    if (validateResults)
+        cout << (empty ? "All empty inputs matched!" : "Some empty inputs did not match!") << endl;
+    cout << "-------------------------" << endl << endl;
+}
+
+void insertBuffered(RStarTree<>& tree, const vector<Object<>>& dataPoints, int bufferSize) {
+    auto start = high_resolution_clock::now();
+    tree.enableBuffering(bufferSize);
+    for (const auto& rect : dataPoints)
+        tree.bufferedInsert(rect);
+    auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
+    cout << "Entries left in buffer: " << tree.buffer.size() << endl;
+}
+
+// Calls optimize until nothing is left to re-pack, reporting the longest single call as the pause
+void optimize(RStarTree<>& tree, int budget) {
+    vector<float> querySize(tree.dimensions, 50.5F);
+    double accessesBefore = tree.expectedNodeAccesses(querySize);
+    long long totalTime = 0, longestPause = 0;
+    size_t moved = 0, calls = 0;
+
+    while (true) {
+        auto start = high_resolution_clock::now();
+        size_t objects = tree.optimize(budget, 0.1);
+        auto duration = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+        if (objects == 0) break;
+        totalTime += duration;
+        longestPause = max(longestPause, static_cast<long long>(duration));
+        moved += objects;
+        ++calls;
+    }
+
+    cout << "Optimize calls: " << calls << " (budget " << budget << " objects)" << endl;
+    cout << "Objects re-packed: " << moved << endl;
+    cout << "Total optimize time: " << totalTime / 1000000.0 << " s, longest pause: " << longestPause / 1000.0 << " ms" << endl;
+    cout << "Expected node accesses per query: " << accessesBefore << " -> " << tree.expectedNodeAccesses(querySize) << endl;
+}
+
+// Moves every object by a random step of up to maxStep per dimension through update()
+void moveObjects(RStarTree<>& tree, vector<Object<>>& dataPoints, float maxStep) {
+    bool allUpdated = true;
+    auto start = high_resolution_clock::now();
+    for (auto& object : dataPoints) {
+        Object<> moved = object;
+        for (size_t d = 0; d < moved.minCoords.size(); ++d) {
+            float step = maxStep * (2.0F * rand() / RAND_MAX - 1.0F);
+            moved.minCoords[d] += step;
+            moved.maxCoords[d] += step;
+        }
+        allUpdated = tree.update(object.payload, object, moved) && allUpdated;
+        object = moved;
+    }
+    auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    cout << "Update time: " << duration.count() / 1000.0 << " s" << endl;
+    if (!allUpdated)
+        cout << "Some updates did not find their object!" << endl;
+}
+
+// Purges square regions with removeRange, and the same regions one object at a time from a
+// copy of the tree; then odd ids from a few more regions through a filter. dataPoints keeps
+// the survivors for validation.
+void purgeRegions(RStarTree<>& tree, RStarTree<>& treeOneByOne, vector<Object<>>& dataPoints, int maxRange) {
+    vector<Rectangle> regions;
+    for (float share : {0.05F, 0.05F, 0.05F, 0.05F, 0.05F, 0.05F, 0.05F, 0.05F, 0.2F, 0.2F}) {
+        float width = maxRange * share;
+        float x = static_cast<float>(rand() % static_cast<int>(maxRange - width + 1));
+        float y = static_cast<float>(rand() % static_cast<int>(maxRange - width + 1));
+        regions.emplace_back(vector<float>{x, y}, vector<float>{x + width, y + width});
+    }
+
+    size_t removed = 0;
+    auto start = high_resolution_clock::now();
+    for (const auto& region : regions)
+        removed += tree.removeRange(region);
+    auto rangeTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+    start = high_resolution_clock::now();
+    for (const auto& region : regions) {
+        for (const auto& object : treeOneByOne.rangeQuery(region))
+            treeOneByOne.remove(object);
+    }
+    auto oneByOneTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+    auto odd = [](const Rectangle&, const int64_t& id) { return id % 2 == 1; };
+    vector<Rectangle> filtered(regions.begin(), regions.begin() + 3);
+    for (auto& region : filtered) {
+        for (auto& coord : region.minCoords) coord += maxRange * 0.02F;
+        for (auto& coord : region.maxCoords) coord += maxRange * 0.02F;
+        removed += tree.removeRange(region, odd);
+    }
+
+    dataPoints.erase(remove_if(dataPoints.begin(), dataPoints.end(), [&](const Object<>& object) {
+        for (const auto& region : regions)
+            if (region.overlapCheck(object)) return true;
+        for (const auto& region : filtered)
+            if (region.overlapCheck(object) && object.payload % 2 == 1) return true;
+        return false;
+    }), dataPoints.end());
+
+    cout << "Objects removed: " << removed << " | objects left: " << tree.analyze().objects << " (expected " << dataPoints.size() << ")" << endl;
+    cout << "Range removal time: " << rangeTime / 1000.0 << " ms | one remove per object: " << oneByOneTime / 1000.0 << " ms" << endl;
+    if (tree.analyze().objects != dataPoints.size())
+        cout << "Some removals did not match!" << endl;
+}
+
+void compressLeaves(RStarTree<>& tree) {
+    float sizeBefore = tree.calculateSizeInMB();
+    auto start = high_resolution_clock::now();
+    tree.compressLeaves();
+    auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    cout << "Compression time: " << duration.count() / 1000.0 << " s" << endl;
+    cout << "Size in MB before compression: " << sizeBefore << endl;
+}
+
+// Bulk loads half of the data, batch inserts a quarter, and inserts the rest one by one
+void recordWorkload(RecordingRStarTree<>& recorder, const vector<Object<>>& dataPoints, int capacity) {
+    auto start = high_resolution_clock::now();
+    size_t half = dataPoints.size() / 2, threeQuarters = dataPoints.size() * 3 / 4;
+    vector<Object<>> objects(dataPoints.begin(), dataPoints.begin() + half);
+    recorder.bulkLoad(objects);
+    for (size_t first = half; first < threeQuarters; first += 10 * capacity) {
+        objects.assign(dataPoints.begin() + first, dataPoints.begin() + min(first + 10 * capacity, threeQuarters));
+        recorder.batchInsert(objects);
+    }
+    for (size_t i = threeQuarters; i < dataPoints.size(); ++i)
+        recorder.insert(dataPoints[i]);
+    auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
+}
+
+CompactTree<> compact(const RStarTree<>& tree, CompactTree<>::Layout layout) {
+    auto start = high_resolution_clock::now();
+    CompactTree<> replica = tree.compact(layout);
+    auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    cout << "Compaction time: " << duration.count() / 1000.0 << " s" << endl;
+    cout << "Replica size in MB: " << replica.sizeInBytes() / (1024.0 * 1024.0) << endl;
+    return replica;
+}
+
+vector<Object<>> linearScanQuery(const vector<Object<>>& points, const Rectangle& query) {
+    vector<Object<>> results;
 
     for (const auto& point : points) {
         if (query.overlapCheck(point))
@@ -101,7 +326,9 @@ vector<Rectangle> linearScanQuery(const vector<Rectangle>& points, const Rectang
     return results;
 }
 
-void performQueries(RStarTree& tree, const vector<Rectangle>& dataPoints, int numQueries, int maxRange, bool validateResults) {
+// Works on any tree with rangeQuery, including compact replicas
+template <typename Tree>
+void performQueries(Tree& tree, const vector<Object<>>& dataPoints, int numQueries, int maxRange, bool validateResults) {
     bool allQueriesMatch = true;
     auto totalTreeQueryTime = 0.0, linearScanQueryTime = 0.0;
 
@@ -110,7 +337,7 @@ void performQueries(RStarTree& tree, const vector<Rectangle>& dataPoints, int nu
         float queryMinY = static_cast<float>(rand() % maxRange);
         float queryMaxX = queryMinX + static_cast<float>(rand() % 100 + 1);
         float queryMaxY = queryMinY + static_cast<float>(rand() % 100 + 1);
-        Rectangle query(i, {queryMinX, queryMinY}, {queryMaxX, queryMaxY});
+        Rectangle query({queryMinX, queryMinY}, {queryMaxX, queryMaxY});
 
         auto start = high_resolution_clock::now();
         auto rtreeResults = tree.rangeQuery(query);
@@ -157,12 +384,259 @@ void performQueries(RStarTree& tree, const vector<Rectangle>& dataPoints, int nu
     cout << "Total R*Tree query time: " << totalTreeQueryTime / 1000000 << "s" << endl;
 }
 
-void report(RStarTree& tree){
+void performPredicateQueries(RStarTree<>& tree, const vector<Object<>>& dataPoints, int numQueries, int maxRange, bool validateResults) {
+    bool allQueriesMatch = true;
+    auto totalTreeQueryTime = 0.0;
+    const char* kinds[] = {"within", "contains point", "distance", "within AND distance"};
+
+    for (int i = 0; i < numQueries; ++i) {
+        float queryMinX = static_cast<float>(rand() % maxRange);
+        float queryMinY = static_cast<float>(rand() % maxRange);
+        Rectangle window({queryMinX, queryMinY}, {queryMinX + static_cast<float>(rand() % 1000 + 1), queryMinY + static_cast<float>(rand() % 1000 + 1)});
+        // A stored point, so containsPoint has matches (the window corner when there is no data)
+        vector<float> target = dataPoints.empty() ? window.minCoords : dataPoints[rand() % dataPoints.size()].minCoords;
+        float radius = static_cast<float>(rand() % 500 + 1);
+
+        vector<Predicate> predicates;
+        int kind = i % 4;
+        if (kind == 0) predicates = {Predicate::within(window)};
+        if (kind == 1) predicates = {Predicate::containsPoint(target)};
+        if (kind == 2) predicates = {Predicate::withinDistance(window.minCoords, radius)};
+        if (kind == 3) predicates = {Predicate::within(window), Predicate::withinDistance(window.minCoords, radius)};
+
+        auto start = high_resolution_clock::now();
+        auto rtreeResults = tree.query(predicates);
+        totalTreeQueryTime += duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        if (!validateResults) continue;
+
+        size_t linearScanCount = 0;
+        for (const auto& point : dataPoints) {
+            if (all_of(predicates.begin(), predicates.end(), [&point](const Predicate& p) { return p.matches(point); }))
+                ++linearScanCount;
+        }
+
+        if (rtreeResults.size() != linearScanCount) {
+            allQueriesMatch = false;
+            cout << "Predicate query (" << kinds[kind] << ") R*tree results count: " << rtreeResults.size() << " | Linear scan results count: " << linearScanCount << endl;
+            break;
+        }
+    }
+
+    cout << "Number of predicate queries: " << numQueries << endl;
+    if (validateResults)
+        cout << (allQueriesMatch ? "All predicate queries matched!" : "Some predicate queries did not match!") << endl;
+    cout << "Total R*Tree predicate query time: " << totalTreeQueryTime / 1000000 << "s" << endl;
+}
+
+void performPagedQueries(RStarTree<>& tree, int numQueries, int maxRange, bool validateResults) {
+    const size_t pageSize = 100;
+    bool allQueriesMatch = true;
+    auto firstPageTime = 0.0, totalCursorTime = 0.0;
+
+    for (int i = 0; i < numQueries; ++i) {
+        float queryMinX = static_cast<float>(rand() % maxRange);
+        float queryMinY = static_cast<float>(rand() % maxRange);
+        Rectangle query({queryMinX, queryMinY}, {queryMinX + static_cast<float>(rand() % 10000 + 1), queryMinY + static_cast<float>(rand() % 10000 + 1)});
+
+        auto start = high_resolution_clock::now();
+        auto cursor = tree.cursor(query);
+        vector<Object<>> page;
+        size_t total = cursor.next(pageSize, page);
+        firstPageTime += duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        while (page.clear(), cursor.next(pageSize, page) > 0)
+            total += page.size();
+        totalCursorTime += duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        if (validateResults && total != tree.rangeQuery(query).size()) {
+            allQueriesMatch = false;
+            cout << "Paged results count: " << total << " | R*tree results count: " << tree.rangeQuery(query).size() << endl;
+            break;
+        }
+    }
+
+    cout << "Number of paged queries: " << numQueries << " (page size " << pageSize << ")" << endl;
+    if (validateResults)
+        cout << (allQueriesMatch ? "All paged queries matched!" : "Some paged queries did not match!") << endl;
+    cout << "Total time to first page: " << firstPageTime / 1000000 << "s" << endl;
+    cout << "Total time to last page: " << totalCursorTime / 1000000 << "s" << endl;
+}
+
+// Tile-rendering workload: a grid of small adjacent windows answered one by one and as a batch
+void performBatchQueries(RStarTree<>& tree, int numQueries, int maxRange, bool validateResults) {
+    const float tileSize = 100.0F;
+    int tilesPerRow = max(1, static_cast<int>(sqrt(numQueries)));
+    float originX = static_cast<float>(rand() % maxRange);
+    float originY = static_cast<float>(rand() % maxRange);
+
+    vector<Rectangle> tiles;
+    for (int row = 0; row < tilesPerRow; ++row) {
+        for (int column = 0; column < tilesPerRow; ++column) {
+            float x = originX + column * tileSize, y = originY + row * tileSize;
+            tiles.emplace_back(vector<float>{x, y}, vector<float>{x + tileSize, y + tileSize});
+        }
+    }
+
+    auto start = high_resolution_clock::now();
+    vector<size_t> counts;
+    for (const auto& tile : tiles)
+        counts.push_back(tree.rangeQuery(tile).size());
+    auto singleTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+    start = high_resolution_clock::now();
+    auto batchResults = tree.rangeQueryBatch(tiles);
+    auto batchTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+    cout << "Number of batched queries: " << tiles.size() << " (" << tilesPerRow << "x" << tilesPerRow << " tiles)" << endl;
+    if (validateResults) {
+        bool allQueriesMatch = true;
+        for (size_t q = 0; q < tiles.size(); ++q)
+            allQueriesMatch = allQueriesMatch && batchResults[q].size() == counts[q];
+        cout << (allQueriesMatch ? "All batched queries matched!" : "Some batched queries did not match!") << endl;
+    }
+    cout << "Total one-by-one query time: " << singleTime / 1000000.0 << "s" << endl;
+    cout << "Total batched query time: " << batchTime / 1000000.0 << "s" << endl;
+}
+
+// Map-preview workload: k objects per window, drawn by sample() or by a range query followed
+// by reservoir sampling, for windows covering a growing share of the space
+void performSampling(RStarTree<>& tree, int numQueries, int maxRange, bool validateResults) {
+    const size_t k = 1000;
+    mt19937 gen(0);
+    bool allSamplesMatch = true;
+
+    for (float share : {0.01F, 0.05F, 0.2F, 0.5F}) {
+        float width = maxRange * share;
+        vector<Rectangle> windows;
+        for (int i = 0; i < max(1, numQueries / 10); ++i) {
+            float x = static_cast<float>(rand() % static_cast<int>(maxRange - width + 1));
+            float y = static_cast<float>(rand() % static_cast<int>(maxRange - width + 1));
+            windows.emplace_back(vector<float>{x, y}, vector<float>{x + width, y + width});
+        }
+
+        auto start = high_resolution_clock::now();
+        vector<vector<Object<>>> samples;
+        for (const auto& window : windows)
+            samples.push_back(tree.sample(window, k, gen));
+        auto sampleTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        start = high_resolution_clock::now();
+        vector<size_t> matches;
+        for (const auto& window : windows) {
+            vector<Object<>> results = tree.rangeQuery(window);
+            vector<Object<>> reservoir;
+            for (size_t i = 0; i < results.size(); ++i) {
+                if (reservoir.size() < k)
+                    reservoir.push_back(results[i]);
+                else {
+                    size_t slot = uniform_int_distribution<size_t>(0, i)(gen);
+                    if (slot < k) reservoir[slot] = results[i];
+                }
+            }
+            matches.push_back(results.size());
+        }
+        auto reservoirTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        if (validateResults) {
+            for (size_t q = 0; q < windows.size(); ++q) {
+                set<int64_t> ids;
+                for (const auto& object : samples[q])
+                    allSamplesMatch = allSamplesMatch && windows[q].overlapCheck(object) && ids.insert(object.payload).second;
+                allSamplesMatch = allSamplesMatch && samples[q].size() == min(k, matches[q]);
+            }
+        }
+        cout << "Window " << share * 100 << "% wide | sample time: " << sampleTime / 1000.0 << " ms"
+             << " | range query and reservoir time: " << reservoirTime / 1000.0 << " ms" << endl;
+    }
+    if (validateResults)
+        cout << (allSamplesMatch ? "All samples matched!" : "Some samples did not match!") << endl;
+}
+
+// Stand-in for a per-object intensity, spread over [0, 1000) independently of the location
+float intensity(const int64_t& id) {
+    return static_cast<float>((static_cast<uint64_t>(id) * 2654435761ULL) % 1000003ULL) / 1000.0F;
+}
+
+// Scores are on before any object arrives, so bulk loading, batch inserts, splits, and single
+// inserts all have to keep the node bounds up to date
+void insertScored(RStarTree<>& tree, const vector<Object<>>& dataPoints) {
+    auto start = high_resolution_clock::now();
+    tree.enableScores(intensity);
+    size_t half = dataPoints.size() / 2, threeQuarters = dataPoints.size() * 3 / 4;
+    vector<Object<>> objects(dataPoints.begin(), dataPoints.begin() + half);
+    tree.bulkLoad(objects);
+    objects.assign(dataPoints.begin() + half, dataPoints.begin() + threeQuarters);
+    tree.batchInsert(objects);
+    for (size_t i = threeQuarters; i < dataPoints.size(); ++i)
+        tree.insert(dataPoints[i]);
+    auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
+}
+
+// topK against a range query followed by a partial sort, over windows of growing size
+void performTopK(RStarTree<>& tree, int numQueries, int maxRange, bool validateResults) {
+    const size_t k = 50;
+    bool allTopKMatch = true;
+
+    for (float share : {0.01F, 0.05F, 0.2F, 0.5F}) {
+        float width = maxRange * share;
+        vector<Rectangle> windows;
+        for (int i = 0; i < max(1, numQueries / 10); ++i) {
+            float x = static_cast<float>(rand() % static_cast<int>(maxRange - width + 1));
+            float y = static_cast<float>(rand() % static_cast<int>(maxRange - width + 1));
+            windows.emplace_back(vector<float>{x, y}, vector<float>{x + width, y + width});
+        }
+
+        auto start = high_resolution_clock::now();
+        vector<vector<Object<>>> tops;
+        for (const auto& window : windows)
+            tops.push_back(tree.topK(window, k));
+        auto topKTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        start = high_resolution_clock::now();
+        vector<vector<float>> expected;
+        for (const auto& window : windows) {
+            vector<float> scores;
+            for (const auto& object : tree.rangeQuery(window))
+                scores.push_back(intensity(object.payload));
+            size_t count = min(k, scores.size());
+            partial_sort(scores.begin(), scores.begin() + count, scores.end(), greater<float>());
+            scores.resize(count);
+            expected.push_back(move(scores));
+        }
+        auto sortTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        // Equal scores may come in any order, so compare score sequences
+        if (validateResults) {
+            for (size_t q = 0; q < windows.size(); ++q) {
+                allTopKMatch = allTopKMatch && tops[q].size() == expected[q].size();
+                for (size_t i = 0; allTopKMatch && i < tops[q].size(); ++i)
+                    allTopKMatch = windows[q].overlapCheck(tops[q][i]) && intensity(tops[q][i].payload) == expected[q][i];
+            }
+        }
+        cout << "Window " << share * 100 << "% wide | top-" << k << " time: " << topKTime / 1000.0 << " ms"
+             << " | range query and sort time: " << sortTime / 1000.0 << " ms" << endl;
+    }
+    if (validateResults)
+        cout << (allTopKMatch ? "All top-k results matched!" : "Some top-k results did not match!") << endl;
+}
+
+void report(RStarTree<>& tree, const string& analysis){
     cout << "Tree info" << endl;
     cout << "   Dimension: " << tree.dimensions << endl;
     cout << "   Capacity: " << tree.maxEntries << endl;
     cout << "   Min capacity: " << tree.minEntries << endl << endl;
     cout << "   Size in MB: " << tree.calculateSizeInMB() << endl << endl;
+
+    if (!analysis.empty()) {
+        TreeStats stats = tree.analyze();
+        if (analysis == "csv") cout << stats.toCSV();
+        else if (analysis == "json") cout << stats.toJSON() << endl;
+        else stats.print(cout);
+        // Query windows in performQueries are 1 to 100 units wide
+        cout << "   Expected node accesses per query: " << tree.expectedNodeAccesses(vector<float>(tree.dimensions, 50.5F)) << endl << endl;
+    }
     cout << "-------------------------" << endl << endl;
 }
 
@@ -173,31 +647,132 @@ int main(int argc, char* argv[]) {
     int capacity = 128;
     int numData = 10000;
     int numQueries = 1000;
+    int bufferSize = 4096;
+    bool pointData = false;
+    int optimizeBudget = 10000;
+    string analysis;
     bool validateResults = false;
+    string recordFile;
     int spaceMin = 0;
     int spaceMax = 100000;
 
-    parseArguments(argc, argv, numData, numQueries, dimension, capacity, validateResults);
+    parseArguments(argc, argv, numData, numQueries, dimension, capacity, bufferSize, pointData, optimizeBudget, analysis, validateResults, recordFile);
+
+    vector<Object<>> dataPoints = generateRandomData(numData, spaceMin, spaceMax);
 
-    vector<Rectangle> dataPoints = generateRandomData(numData, spaceMin, spaceMax);
+    cout << "*Test: Empty input*" << endl;
+    checkEmptyInput(capacity, dimension, pointData, validateResults);
 
     cout << "*Test: Insertion*" << endl;
-    RStarTree treeOneByOne(capacity, dimension);
+    RStarTree<> treeOneByOne(capacity, dimension, pointData);
     insert(treeOneByOne, dataPoints);
     performQueries(treeOneByOne, dataPoints, numQueries, spaceMax, validateResults);
-    report(treeOneByOne);
+    report(treeOneByOne, analysis);
 
     cout << "*Test: Batch insertion*" << endl;
-    RStarTree treeBatch(capacity, dimension);
+    RStarTree<> treeBatch(capacity, dimension, pointData);
     insertBatches(treeBatch, dataPoints, capacity);
     performQueries(treeBatch, dataPoints, numQueries, spaceMax, validateResults);
-    report(treeBatch);
+    report(treeBatch, analysis);
 
     cout << "*Test: Bulk loading*" << endl;
-    RStarTree treeBulk(capacity, dimension);
+    RStarTree<> treeBulk(capacity, dimension, pointData);
     insertBulkLoad(treeBulk, dataPoints);
     performQueries(treeBulk, dataPoints, numQueries, spaceMax, validateResults);
-    report(treeBulk);
+    performPredicateQueries(treeBulk, dataPoints, numQueries, spaceMax, validateResults);
+    performPagedQueries(treeBulk, numQueries, spaceMax, validateResults);
+    performBatchQueries(treeBulk, numQueries, spaceMax, validateResults);
+    report(treeBulk, analysis);
+
+    cout << "*Test: Sampling*" << endl;
+    performSampling(treeBulk, numQueries, spaceMax, validateResults);
+    cout << "-------------------------" << endl << endl;
+
+    cout << "*Test: Prefetching traversal*" << endl;
+    treeBulk.traversal = RStarTree<>::PREFETCH_BREADTH_FIRST;
+    performQueries(treeBulk, dataPoints, numQueries, spaceMax, validateResults);
+    report(treeBulk, analysis);
+
+    cout << "*Test: Compact layout (breadth-first)*" << endl;
+    CompactTree<> replicaBFS = compact(treeBulk, CompactTree<>::BREADTH_FIRST);
+    performQueries(replicaBFS, dataPoints, numQueries, spaceMax, validateResults);
+    cout << "-------------------------" << endl << endl;
+
+    cout << "*Test: Compact layout (van Emde Boas)*" << endl;
+    CompactTree<> replicaVEB = compact(treeBulk, CompactTree<>::VAN_EMDE_BOAS);
+    performQueries(replicaVEB, dataPoints, numQueries, spaceMax, validateResults);
+    cout << "-------------------------" << endl << endl;
+
+    cout << "*Test: Compressed leaves*" << endl;
+    vector<Object<>> compressedPoints = dataPoints;
+    RStarTree<> treeCompressed(capacity, dimension, pointData);
+    treeCompressed.bulkLoad(compressedPoints);
+    compressLeaves(treeCompressed);
+    performQueries(treeCompressed, dataPoints, numQueries, spaceMax, validateResults);
+    report(treeCompressed, analysis);
+
+    cout << "*Test: Buffered insertion*" << endl;
+    RStarTree<> treeBuffered(capacity, dimension, pointData);
+    insertBuffered(treeBuffered, dataPoints, bufferSize);
+    performQueries(treeBuffered, dataPoints, numQueries, spaceMax, validateResults);
+    performPredicateQueries(treeBuffered, dataPoints, numQueries, spaceMax, validateResults);
+    performPagedQueries(treeBuffered, numQueries, spaceMax, validateResults);
+    report(treeBuffered, analysis);
+
+    cout << "*Test: Online repacking*" << endl;
+    optimize(treeBuffered, optimizeBudget);
+    performQueries(treeBuffered, dataPoints, numQueries, spaceMax, validateResults);
+    report(treeBuffered, analysis);
+
+    cout << "*Test: Moving objects (delete and reinsert)*" << endl;
+    vector<Object<>> movedPoints = dataPoints;
+    RStarTree<> treeReinsert(capacity, dimension, pointData);
+    treeReinsert.bulkLoad(movedPoints);
+    moveObjects(treeReinsert, movedPoints, 100.0F);
+    performQueries(treeReinsert, movedPoints, numQueries, spaceMax, validateResults);
+    report(treeReinsert, analysis);
+
+    cout << "*Test: Moving objects (bottom-up update)*" << endl;
+    movedPoints = dataPoints;
+    RStarTree<> treeMoving(capacity, dimension, pointData);
+    treeMoving.bulkLoad(movedPoints);
+    treeMoving.enableUpdates(50.0F);
+    moveObjects(treeMoving, movedPoints, 100.0F);
+    performQueries(treeMoving, movedPoints, numQueries, spaceMax, validateResults);
+    report(treeMoving, analysis);
+
+    cout << "*Test: Columnar bulk loading*" << endl;
+    RStarTree<> treeColumnar(capacity, dimension, pointData);
+    insertColumnar(treeColumnar, dataPoints);
+    performQueries(treeColumnar, dataPoints, numQueries, spaceMax, validateResults);
+    report(treeColumnar, analysis);
+
+    cout << "*Test: Top-k by score*" << endl;
+    RStarTree<> treeScored(capacity, dimension, pointData);
+    insertScored(treeScored, dataPoints);
+    performTopK(treeScored, numQueries, spaceMax, validateResults);
+    report(treeScored, analysis);
+
+    cout << "*Test: Range removal*" << endl;
+    vector<Object<>> purgedPoints = dataPoints;
+    RStarTree<> treePurged(capacity, dimension, pointData), treePurgedOneByOne(capacity, dimension, pointData);
+    treePurged.bulkLoad(purgedPoints);
+    purgedPoints = dataPoints;
+    treePurgedOneByOne.bulkLoad(purgedPoints);
+    purgedPoints = dataPoints;
+    purgeRegions(treePurged, treePurgedOneByOne, purgedPoints, spaceMax);
+    performQueries(treePurged, purgedPoints, numQueries, spaceMax, validateResults);
+    report(treePurged, analysis);
+
+    if (!recordFile.empty()) {
+        cout << "*Test: Workload recording*" << endl;
+        RecordingRStarTree<> recorder(recordFile, capacity, dimension, pointData);
+        recordWorkload(recorder, dataPoints, capacity);
+        performQueries(recorder, dataPoints, numQueries, spaceMax, validateResults);
+        recorder.flush();
+        cout << "Trace written to " << recordFile << endl;
+        report(recorder.tree, analysis);
+    }
 
     cout << endl << "Benchmark completed." << endl << endl;
     return 0;
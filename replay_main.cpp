@@ -0,0 +1,204 @@
+/*
+=====================================================================
+R*-Tree Demo: Workload replay
+=====================================================================
+
+What does it test?
+    Re-executes a recorded WorkloadTrace (see main.cpp -r) against a
+    tree of any configuration.
+
+What does it do?
+    - Loads the trace and keeps the selected operations, time window,
+      and share of the queries (optionally repeating them).
+    - Replays it as fast as possible, or at the recorded timing
+      (compressed or stretched by a speed factor).
+    - Reports per-operation latency percentiles and throughput.
+
+Command-line arguments:
+    - `-t` / `--trace`: Trace file to replay (default: workload.trace).
+    - `-c` / `--capacity`: Node capacity (default: 128).
+    - `-p` / `--points`: Store leaves as points instead of rectangles (default: off).
+    - `-o` / `--ops`: Comma-separated operations to keep, e.g. bulkLoad,rangeQuery (default: all).
+    - `-f` / `--from`: Skip the records before this many seconds into the trace (default: 0).
+    - `-u` / `--until`: Skip the records after this many seconds into the trace (default: end).
+    - `-s` / `--sample`: Share of the queries to keep (default: 1).
+    - `-x` / `--repeat`: Times each kept query is issued (default: 1).
+    - `-r` / `--realtime`: Wait for each record's recorded time (default: off).
+    - `-y` / `--speed`: Speed factor for realtime replay (default: 1).
+=====================================================================
+ */
+
+#include "WorkloadTrace.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <map>
+
+using namespace chrono;
+
+struct ReplayOptions {
+    string traceFile = "workload.trace";
+    int capacity = 128;
+    bool pointData = false;
+    string ops;
+    double from = 0.0;
+    double until = numeric_limits<double>::max();
+    double sample = 1.0;
+    int repeat = 1;
+    bool realtime = false;
+    double speed = 1.0;
+};
+
+void parseArguments(int argc, char* argv[], ReplayOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-t" || arg == "--trace") {
+            if (i + 1 < argc) options.traceFile = argv[++i];
+        } else if (arg == "-c" || arg == "--capacity") {
+            if (i + 1 < argc) options.capacity = atoi(argv[++i]);
+        } else if (arg == "-p" || arg == "--points") {
+            options.pointData = true;
+        } else if (arg == "-o" || arg == "--ops") {
+            if (i + 1 < argc) options.ops = argv[++i];
+        } else if (arg == "-f" || arg == "--from") {
+            if (i + 1 < argc) options.from = atof(argv[++i]);
+        } else if (arg == "-u" || arg == "--until") {
+            if (i + 1 < argc) options.until = atof(argv[++i]);
+        } else if (arg == "-s" || arg == "--sample") {
+            if (i + 1 < argc) options.sample = atof(argv[++i]);
+        } else if (arg == "-x" || arg == "--repeat") {
+            if (i + 1 < argc) options.repeat = max(1, atoi(argv[++i]));
+        } else if (arg == "-r" || arg == "--realtime") {
+            options.realtime = true;
+        } else if (arg == "-y" || arg == "--speed") {
+            if (i + 1 < argc) options.speed = atof(argv[++i]);
+        } else {
+            cout << "Usage: " << argv[0] << " [options]\n";
+            cout << "Options:\n";
+            cout << "  -t, --trace <file>        Trace file to replay (default: workload.trace)\n";
+            cout << "  -c, --capacity <num>      Node capacity of the R*-Tree (default: 128)\n";
+            cout << "  -p, --points              Store leaves as points instead of rectangles (default: off)\n";
+            cout << "  -o, --ops <list>          Operations to keep, e.g. bulkLoad,rangeQuery (default: all)\n";
+            cout << "  -f, --from <seconds>      Skip the records before this time (default: 0)\n";
+            cout << "  -u, --until <seconds>     Skip the records after this time (default: end)\n";
+            cout << "  -s, --sample <share>      Share of the queries to keep (default: 1)\n";
+            cout << "  -x, --repeat <num>        Times each kept query is issued (default: 1)\n";
+            cout << "  -r, --realtime            Replay at the recorded timing (default: off)\n";
+            cout << "  -y, --speed <factor>      Speed factor for realtime replay (default: 1)\n";
+            exit(0);
+        }
+    }
+}
+
+// Keeps the selected operations inside the time window, then thins or repeats the queries
+vector<TraceRecord<>> selectRecords(const vector<TraceRecord<>>& records, const ReplayOptions& options) {
+    mt19937 gen(0);
+    uniform_real_distribution<double> coin(0.0, 1.0);
+    vector<TraceRecord<>> selected;
+
+    for (const auto& record : records) {
+        double seconds = record.micros / 1000000.0;
+        if (seconds < options.from || seconds > options.until) continue;
+        if (!options.ops.empty() && ("," + options.ops + ",").find(string(",") + TraceRecord<>::name(record.op) + ",") == string::npos)
+            continue;
+
+        if (record.op != TraceRecord<>::RANGE_QUERY) {
+            selected.push_back(record);
+            continue;
+        }
+        if (coin(gen) >= options.sample) continue;
+        for (int r = 0; r < options.repeat; ++r)
+            selected.push_back(record);
+    }
+    return selected;
+}
+
+struct OperationStats {
+    vector<double> latencies; // Microseconds
+    size_t objects = 0;
+    size_t results = 0;
+};
+
+double percentile(vector<double>& values, double share) {
+    if (values.empty()) return 0.0;
+    size_t index = min(values.size() - 1, static_cast<size_t>(share * values.size()));
+    nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+int main(int argc, char* argv[]) {
+    ReplayOptions options;
+    parseArguments(argc, argv, options);
+
+    WorkloadTrace<> trace;
+    if (!trace.load(options.traceFile)) return 1;
+    vector<TraceRecord<>> records = selectRecords(trace.records, options);
+    cout << "Trace: " << options.traceFile << " | records: " << trace.records.size() << " | replaying: " << records.size()
+         << (options.realtime ? " at recorded timing" : " as fast as possible");
+    if (options.realtime) cout << " (speed " << options.speed << "x)";
+    cout << endl;
+
+    RStarTree<> tree(options.capacity, trace.dimensions, options.pointData);
+    map<string, OperationStats> stats;
+    uint64_t firstMicros = records.empty() ? 0 : records.front().micros;
+    auto replayStart = steady_clock::now();
+
+    for (auto& record : records) {
+        if (options.realtime) {
+            auto due = replayStart + microseconds(static_cast<long long>((record.micros - firstMicros) / options.speed));
+            this_thread::sleep_until(due);
+        }
+
+        // Only known operations get an entry; a single-object call needs its object
+        bool known = record.op >= TraceRecord<>::INSERT && record.op <= TraceRecord<>::RANGE_QUERY;
+        bool single = record.op == TraceRecord<>::INSERT || record.op == TraceRecord<>::RANGE_QUERY;
+        if (!known || (single && record.objects.empty())) continue;
+
+        OperationStats& stat = stats[TraceRecord<>::name(record.op)];
+        auto start = steady_clock::now();
+        switch (record.op) {
+            case TraceRecord<>::INSERT:
+                tree.insert(record.objects.front());
+                break;
+            case TraceRecord<>::BATCH_INSERT: {
+                vector<Object<>> objects = record.objects;
+                start = steady_clock::now();
+                tree.batchInsert(objects);
+                break;
+            }
+            case TraceRecord<>::BULK_LOAD: {
+                vector<Object<>> objects = record.objects;
+                start = steady_clock::now();
+                tree.bulkLoad(objects);
+                break;
+            }
+            case TraceRecord<>::RANGE_QUERY:
+                stat.results += tree.rangeQuery(record.objects.front()).size();
+                break;
+            default:
+                continue;
+        }
+        stat.latencies.push_back(duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1000.0);
+        stat.objects += record.op == TraceRecord<>::RANGE_QUERY ? 0 : record.objects.size();
+    }
+    double wallTime = duration_cast<microseconds>(steady_clock::now() - replayStart).count() / 1000000.0;
+
+    for (auto& entry : stats) {
+        OperationStats& stat = entry.second;
+        double busy = accumulate(stat.latencies.begin(), stat.latencies.end(), 0.0) / 1000000.0;
+        cout << entry.first << " | calls: " << stat.latencies.size();
+        if (stat.objects) cout << " | objects: " << stat.objects;
+        if (entry.first == "rangeQuery") cout << " | results: " << stat.results;
+        cout << " | time: " << busy << " s"
+             << " | throughput: " << stat.latencies.size() / max(busy, 1e-9) << " calls/s"
+             << " | p50: " << percentile(stat.latencies, 0.5) << " us"
+             << " | p95: " << percentile(stat.latencies, 0.95) << " us"
+             << " | p99: " << percentile(stat.latencies, 0.99) << " us"
+             << " | max: " << percentile(stat.latencies, 1.0) << " us" << endl;
+    }
+    cout << "Replay wall time: " << wallTime << " s" << endl;
+    cout << endl << "Benchmark completed." << endl << endl;
+    return 0;
+}
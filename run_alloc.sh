@@ -0,0 +1,19 @@
+# Compile
+g++ -std=c++17 -O2 -o alloc_main.exe alloc_main.cpp
+
+# Check if compilation was successful
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+# Count the heap allocations of every single insertion
+# Parameters:
+# -n 50000: Number of data points (50,000)
+# -c 16: Node capacity (16), small enough for frequent splits
+
+echo "Running allocation-free insertion test (rectangles)..."
+./alloc_main.exe -n 50000 -c 16 "$@"
+
+echo "Running allocation-free insertion test (points)..."
+./alloc_main.exe -n 50000 -c 16 -p "$@"
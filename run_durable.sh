@@ -0,0 +1,18 @@
+# Compile
+g++ -std=c++17 -O2 -o durable_main.exe durable_main.cpp
+
+# Check if compilation was successful
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+# Run crash-injection recovery validation
+# Parameters:
+# -n 20000: Number of insert/remove operations (20,000)
+# -r 20: Number of crash-injection rounds (20)
+# -g 64: Group commit size (64)
+# -k 5000: Operations between checkpoints (5,000)
+
+echo "Running durable R*-Tree with crash injection..."
+./durable_main.exe -n 20000 -r 20 -g 64 -k 5000 "$@"
@@ -0,0 +1,17 @@
+# Compile
+g++ -std=c++17 -O2 -o external_main.exe external_main.cpp
+
+# Check if compilation was successful
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+# Build an index file out of core under growing memory budgets
+# Parameters:
+# -n 5000000: Number of generated objects (5,000,000, about 115 MB of input)
+# -m 4,16,64,256: Memory budgets in MB
+# -q 1000: Number of queries (1,000)
+
+echo "Running out-of-core STR bulk loading..."
+./external_main.exe -n 5000000 -m 4,16,64,256 -q 1000 "$@"
@@ -0,0 +1,18 @@
+# Compile
+g++ -std=c++17 -O2 -pthread -o knn_main.exe knn_main.cpp
+
+# Check if compilation was successful
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+# Run the k-nearest-neighbor join with validation
+# Parameters:
+# -n 100000: Number of events (100,000)
+# -m 10000: Number of stations (10,000)
+# -k 5: Neighbors per event (5)
+# -v: Enable validation with linear scan
+
+echo "Running R*-Tree kNN join..."
+./knn_main.exe -n 100000 -m 10000 -k 5 -v "$@"
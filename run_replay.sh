@@ -0,0 +1,24 @@
+# Compile
+g++ -std=c++17 -O2 -o main.exe main.cpp && g++ -std=c++17 -O2 -o replay_main.exe replay_main.cpp
+
+# Check if compilation was successful
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+# Record a workload, then replay it
+# Parameters:
+# -n 20000: Number of data points (20,000)
+# -q 1000: Number of queries (1,000)
+# -r workload.trace: Trace file to record
+# -c 64: Node capacity for the replay (64)
+
+echo "Recording a workload..."
+./main.exe -n 20000 -q 1000 -r workload.trace > /dev/null
+
+echo "Replaying it as fast as possible..."
+./replay_main.exe -t workload.trace -c 64 "$@"
+
+echo "Replaying its queries at 100x the recorded timing..."
+./replay_main.exe -t workload.trace -c 64 -o bulkLoad,batchInsert,insert,rangeQuery -r -y 100 "$@"
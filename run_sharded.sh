@@ -0,0 +1,18 @@
+# Compile
+g++ -std=c++17 -O2 -pthread -o sharded_main.exe sharded_main.cpp
+
+# Check if compilation was successful
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+# Run sharded ingest scaling with validation
+# Parameters:
+# -n 200000: Number of objects (200,000)
+# -q 200: Number of queries (200)
+# -c 128: Node capacity (128)
+# -v: Enable validation with linear scan
+
+echo "Running sharded R*-Tree ingest..."
+./sharded_main.exe -n 200000 -q 200 -c 128 -v "$@"
@@ -14,7 +14,7 @@ done
 echo "Using stream file: $STREAM_FILE"
 
 # Compile the stream_main.cpp file
-g++ -o stream_main stream_main.cpp -std=c++11
+g++ -o stream_main stream_main.cpp -std=c++17
 
 # Check if compilation was successful
 if [ $? -eq 0 ]; then
@@ -0,0 +1,18 @@
+# Compile
+g++ -std=c++17 -O2 -o temporal_main.exe temporal_main.cpp
+
+# Check if compilation was successful
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+# Run time-travel queries on a multiversion tree and on per-snapshot trees
+# Parameters:
+# -n 100000: Number of objects alive at the start (100,000)
+# -s 100: Number of timestamps (100)
+# -u 0.05: Fraction of the objects updated per timestamp (5%)
+# -v: Enable validation against the recorded versions
+
+echo "Running multiversion R*-Tree..."
+./temporal_main.exe -n 100000 -s 100 -u 0.05 -v "$@"
@@ -0,0 +1,187 @@
+/*
+=====================================================================
+R*-Tree Demo: Sharded multi-core ingest
+=====================================================================
+
+What does it test?
+    ShardedRStarTree: spatial shards owned by worker threads.
+
+What does it do?
+    - Partitions space from a 1% sample and ingests the data through
+      1, 2, 4, ... shards (up to the thread limit), each shard applying
+      its own queue on its own thread.
+    - Measures ingest time and the speedup over a single shard.
+    - Validates range queries against a linear scan, including the
+      objects that straddle shard regions.
+
+Command-line arguments:
+    - `-n` / `--numData`: Number of objects (default: 200000).
+    - `-q` / `--numQueries`: Number of queries (default: 200).
+    - `-c` / `--capacity`: Node capacity (default: 128).
+    - `-t` / `--threads`: Largest shard count (default: hardware threads).
+    - `-g` / `--grid`: Partition with an equal grid instead of STR (default: off).
+    - `-u` / `--duplicate`: Duplicate straddling objects instead of assigning them by center (default: off).
+    - `-v` / `--validate`: Validate query results (default: off).
+=====================================================================
+ */
+
+#include "ShardedRStarTree.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+
+using namespace chrono;
+
+void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int& capacity, int& maxThreads, bool& grid, bool& duplicate, bool& validateResults) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-n" || arg == "--numData") {
+            if (i + 1 < argc) numData = atoi(argv[++i]);
+        } else if (arg == "-q" || arg == "--numQueries") {
+            if (i + 1 < argc) numQueries = atoi(argv[++i]);
+        } else if (arg == "-c" || arg == "--capacity") {
+            if (i + 1 < argc) capacity = atoi(argv[++i]);
+        } else if (arg == "-t" || arg == "--threads") {
+            if (i + 1 < argc) maxThreads = atoi(argv[++i]);
+        } else if (arg == "-g" || arg == "--grid") {
+            grid = true;
+        } else if (arg == "-u" || arg == "--duplicate") {
+            duplicate = true;
+        } else if (arg == "-v" || arg == "--validate") {
+            validateResults = true;
+        } else {
+            cout << "Usage: " << argv[0] << " [options]\n";
+            cout << "Options:\n";
+            cout << "  -n, --numData <num>       Number of objects to insert (default: 200000)\n";
+            cout << "  -q, --numQueries <num>    Number of range queries to perform (default: 200)\n";
+            cout << "  -c, --capacity <num>      Node capacity of the R*-Tree (default: 128)\n";
+            cout << "  -t, --threads <num>       Largest shard count (default: hardware threads)\n";
+            cout << "  -g, --grid                Partition with an equal grid instead of STR (default: off)\n";
+            cout << "  -u, --duplicate           Duplicate straddling objects instead of assigning by center (default: off)\n";
+            cout << "  -v, --validate            Enable brute-force validation (default: off)\n";
+            exit(0);
+        }
+    }
+}
+
+// Small rectangles, clustered around a few hot spots so STR and grid partitions differ
+vector<Object<>> generateData(int numData, unsigned seed) {
+    mt19937 gen(seed);
+    uniform_real_distribution<float> uniform(0.0F, 100000.0F);
+    uniform_real_distribution<float> size(0.0F, 200.0F);
+    vector<pair<float, float>> hotSpots;
+    for (int i = 0; i < 8; ++i)
+        hotSpots.push_back({uniform(gen), uniform(gen)});
+    normal_distribution<float> spread(0.0F, 5000.0F);
+
+    vector<Object<>> data;
+    for (int i = 0; i < numData; ++i) {
+        float x, y;
+        if (i % 2 == 0) {
+            const auto& spot = hotSpots[gen() % hotSpots.size()];
+            x = spot.first + spread(gen);
+            y = spot.second + spread(gen);
+        } else {
+            x = uniform(gen);
+            y = uniform(gen);
+        }
+        data.emplace_back(i, vector<float>{x, y}, vector<float>{x + size(gen), y + size(gen)});
+    }
+    return data;
+}
+
+bool validate(ShardedRStarTree<>& tree, const vector<Object<>>& data, const vector<Rectangle>& queries) {
+    for (const auto& query : queries) {
+        vector<int64_t> expected, found;
+        for (const auto& object : data) {
+            if (query.overlapCheck(object))
+                expected.push_back(object.payload);
+        }
+        for (const auto& object : tree.rangeQuery(query))
+            found.push_back(object.payload);
+        sort(expected.begin(), expected.end());
+        sort(found.begin(), found.end());
+        if (expected != found) {
+            cout << "Sharded results count: " << found.size() << " | Linear scan results count: " << expected.size() << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int numData = 200000;
+    int numQueries = 200;
+    int capacity = 128;
+    int maxThreads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    bool grid = false;
+    bool duplicate = false;
+    bool validateResults = false;
+
+    parseArguments(argc, argv, numData, numQueries, capacity, maxThreads, grid, duplicate, validateResults);
+
+    vector<Object<>> data = generateData(numData, 42);
+    mt19937 gen(7);
+    vector<Object<>> sample;
+    for (const auto& object : data) {
+        if (gen() % 100 == 0)
+            sample.push_back(object);
+    }
+
+    uniform_real_distribution<float> coord(0.0F, 100000.0F);
+    vector<Rectangle> queries;
+    for (int i = 0; i < numQueries; ++i) {
+        float x = coord(gen), y = coord(gen);
+        queries.emplace_back(vector<float>{x, y}, vector<float>{x + 2000.0F, y + 2000.0F});
+    }
+
+    auto partitioning = grid ? ShardedRStarTree<>::GRID : ShardedRStarTree<>::STR;
+    auto policy = duplicate ? ShardedRStarTree<>::DUPLICATE : ShardedRStarTree<>::ASSIGN_BY_CENTER;
+    cout << "Partitioning: " << (grid ? "grid" : "STR") << " | straddling objects: " << (duplicate ? "duplicated" : "assigned by center") << endl << endl;
+
+    double singleShardTime = 0.0;
+    bool allQueriesMatch = true;
+    for (int shardCount = 1; shardCount <= maxThreads; shardCount *= 2) {
+        ShardedRStarTree<> tree(sample, shardCount, capacity, 2, partitioning, policy);
+
+        auto start = high_resolution_clock::now();
+        const size_t batchSize = 10000;
+        for (size_t first = 0; first < data.size(); first += batchSize)
+            tree.insert(vector<Object<>>(data.begin() + first, data.begin() + min(first + batchSize, data.size())));
+        tree.flush();
+        double ingestTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+        if (shardCount == 1) singleShardTime = ingestTime;
+
+        start = high_resolution_clock::now();
+        size_t results = 0;
+        for (const auto& query : queries)
+            results += tree.rangeQuery(query).size();
+        double queryTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+
+        size_t stored = 0, smallest = data.size(), largest = 0;
+        for (const auto& shard : tree.shards) {
+            size_t count = 0;
+            shard->tree.forEachObject([&count](const Rectangle&, const int64_t&) { ++count; });
+            stored += count;
+            smallest = min(smallest, count);
+            largest = max(largest, count);
+        }
+
+        cout << "Shards: " << shardCount
+             << " | ingest time: " << ingestTime << " s (speedup " << singleShardTime / ingestTime << "x)"
+             << " | query time: " << queryTime << " s (" << results << " results)"
+             << " | objects per shard: " << smallest << " to " << largest
+             << " | stored copies: " << stored << endl;
+
+        if (validateResults && !validate(tree, data, queries)) {
+            allQueriesMatch = false;
+            cout << "Mismatch with " << shardCount << " shards" << endl;
+        }
+    }
+
+    if (validateResults)
+        cout << (allQueriesMatch ? "All queries matched!" : "Some queries did not match!") << endl;
+    cout << endl << "Benchmark completed." << endl << endl;
+    return allQueriesMatch ? 0 : 1;
+}
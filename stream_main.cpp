@@ -11,6 +11,9 @@ What does it do?
       1. Single Insertions
       2. Batch Insertions
       3. Bulk Loading
+    - Compares estimateCount() against exact range query counts on the
+      bulk-loaded tree (error, how often the exact count falls within the
+      estimate's heuristic spread, and time per depth)
     - Validates range queries results against a linear scan
     - Calculates performance metrics and tree statistics
 
@@ -19,6 +22,8 @@ Command-line arguments:
     - `-q` / `--numQueries`: Number of queries (default: 1000).
     - `-d` / `--dimension`: Data dimensionality (default: 2).
     - `-c` / `--capacity`: Node capacity (default: 128).
+    - `-p` / `--points`: Store leaves as points instead of rectangles (default: off).
+    - `-a` / `--analyze`: Print tree quality per level as text, csv, or json (default: off).
     - `-v` / `--validate`: Validate query results (default: off).
 =====================================================================
  */
@@ -36,7 +41,7 @@ Command-line arguments:
 using namespace chrono;
 using namespace std;
 
-void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int& dimension, int& capacity, bool& validateResults, string& streamFile) {
+void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int& dimension, int& capacity, bool& pointData, string& analysis, bool& validateResults, string& streamFile) {
     for (int i = 1; i < argc; ++i) {
         string arg = argv[i];
         if (arg == "-n" || arg == "--numData") {
@@ -47,6 +52,10 @@ void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int&
             if (i + 1 < argc) dimension = atoi(argv[++i]);
         } else if (arg == "-c" || arg == "--capacity") {
             if (i + 1 < argc) capacity = atoi(argv[++i]);
+        } else if (arg == "-p" || arg == "--points") {
+            pointData = true;
+        } else if (arg == "-a" || arg == "--analyze") {
+            if (i + 1 < argc) analysis = argv[++i];
         } else if (arg == "-v" || arg == "--validate") {
             validateResults = true;
         } else if (arg == "-s" || arg == "--stream") {
@@ -58,6 +67,8 @@ void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int&
             cout << "  -q, --numQueries <num>    Number of range queries to perform (default: 1000)\n";
             cout << "  -d, --dimension <num>     Dimensionality of the data (default: 2)\n";
             cout << "  -c, --capacity <num>      Node capacity of the R*-Tree (default: 128)\n";
+            cout << "  -p, --points              Store leaves as points instead of rectangles (default: off)\n";
+            cout << "  -a, --analyze <format>    Print tree quality per level as text, csv, or json (default: off)\n";
             cout << "  -v, --validate            Enable brute-force validation (default: off)\n";
             cout << "  -s, --stream <file>       Stream file to read (default: streams/WILDFIRES.stream)\n";
             exit(0);
@@ -65,8 +76,8 @@ void parseArguments(int argc, char* argv[], int& numData, int& numQueries, int&
     }
 }
 
-vector<Rectangle> readStreamFile(const string& filename) {
-    vector<Rectangle> dataPoints;
+vector<Object<>> readStreamFile(const string& filename) {
+    vector<Object<>> dataPoints;
     ifstream file(filename);
     
     if (!file.is_open()) {
@@ -76,7 +87,8 @@ vector<Rectangle> readStreamFile(const string& filename) {
     
     string line;
     char type;
-    long id, x, y, dummy;
+    int64_t id;
+    long x, y, dummy;
     
     while (getline(file, line)) {
         istringstream iss(line);
@@ -85,7 +97,7 @@ vector<Rectangle> readStreamFile(const string& filename) {
         // Only process rows that start with 'E'
         if (type == 'E') {
             // Create a point rectangle with the coordinates
-            Rectangle rect(id, {static_cast<float>(x), static_cast<float>(y)}, {static_cast<float>(x), static_cast<float>(y)});
+            Object<> rect(id, {static_cast<float>(x), static_cast<float>(y)}, {static_cast<float>(x), static_cast<float>(y)});
             dataPoints.push_back(rect);
         }
     }
@@ -95,7 +107,7 @@ vector<Rectangle> readStreamFile(const string& filename) {
     return dataPoints;
 }
 
-void insert(RStarTree& tree, const vector<Rectangle>& dataPoints) {
+void insert(RStarTree<>& tree, const vector<Object<>>& dataPoints) {
     auto start = high_resolution_clock::now();
     for (const auto& rect : dataPoints)
         tree.insert(rect);
@@ -103,22 +115,22 @@ void insert(RStarTree& tree, const vector<Rectangle>& dataPoints) {
     cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
 }
 
-void insertBatches(RStarTree& tree, vector<Rectangle>& dataPoints, int capacity) {
+void insertBatches(RStarTree<>& tree, vector<Object<>>& dataPoints, int capacity) {
     auto start = high_resolution_clock::now();
     tree.batchInsert(dataPoints);
     auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
     cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
 }
 
-void insertBulkLoad(RStarTree& tree, vector<Rectangle>& dataPoints) {
+void insertBulkLoad(RStarTree<>& tree, vector<Object<>>& dataPoints) {
     auto start = high_resolution_clock::now();
     tree.bulkLoad(dataPoints); 
     auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
     cout << "Insertion time: " << duration.count() / 1000.0 << " s" << endl;
 }
 
-vector<Rectangle> linearScanQuery(const vector<Rectangle>& points, const Rectangle& query) {
-    vector<Rectangle> results;
+vector<Object<>> linearScanQuery(const vector<Object<>>& points, const Rectangle& query) {
+    vector<Object<>> results;
 
     for (const auto& point : points) {
         if (query.overlapCheck(point)) {
@@ -128,7 +140,7 @@ vector<Rectangle> linearScanQuery(const vector<Rectangle>& points, const Rectang
     return results;
 }
 
-void performQueries(RStarTree& tree, const vector<Rectangle>& dataPoints, int numQueries, int maxRange, bool validateResults) {
+void performQueries(RStarTree<>& tree, const vector<Object<>>& dataPoints, int numQueries, int maxRange, bool validateResults) {
     long long totalTreeQueryTime = 0;
     long long linearScanQueryTime = 0;
     bool allQueriesMatch = true;
@@ -199,7 +211,7 @@ void performQueries(RStarTree& tree, const vector<Rectangle>& dataPoints, int nu
             queryMaxY = queryMinY + static_cast<float>(rand() % static_cast<int>(rangeY * 0.2 + 1));
         }
         
-        Rectangle query(-1, {queryMinX, queryMinY}, {queryMaxX, queryMaxY});
+        Rectangle query({queryMinX, queryMinY}, {queryMaxX, queryMaxY});
 
         auto start = high_resolution_clock::now();
         auto rtreeResults = tree.rangeQuery(query);
@@ -248,12 +260,70 @@ void performQueries(RStarTree& tree, const vector<Rectangle>& dataPoints, int nu
     cout << "Total R*Tree query time: " << totalTreeQueryTime / 1000000 << "s" << endl;
 }
 
-void report(RStarTree& tree){
+// Exact counts against estimateCount() on windows of 1% to 20% of the data range
+void performEstimates(RStarTree<>& tree, int numQueries) {
+    Rectangle space = tree.nodeMBR(tree.root);
+    vector<Rectangle> queries;
+    for (int i = 0; i < numQueries; ++i) {
+        vector<float> low(tree.dimensions), high(tree.dimensions);
+        for (int d = 0; d < tree.dimensions; ++d) {
+            float range = space.maxCoords[d] - space.minCoords[d];
+            float width = range * (1 + rand() % 20) / 100.0F;
+            low[d] = space.minCoords[d] + (range - width) * (rand() / static_cast<float>(RAND_MAX));
+            high[d] = low[d] + width;
+        }
+        queries.emplace_back(low, high);
+    }
+
+    vector<size_t> exact;
+    auto start = high_resolution_clock::now();
+    for (const auto& query : queries)
+        exact.push_back(tree.rangeQuery(query).size());
+    auto exactTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    cout << "Exact counts time: " << exactTime / 1000.0 << " ms" << endl;
+
+    for (int depth = 1; depth <= 3; ++depth) {
+        double totalError = 0.0;
+        size_t withinSpread = 0, nodesVisited = 0;
+        start = high_resolution_clock::now();
+        vector<CountEstimate> estimates;
+        for (const auto& query : queries)
+            estimates.push_back(tree.estimateCount(query, depth));
+        auto estimateTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const CountEstimate& estimate = estimates[i];
+            totalError += fabs(estimate.estimate - exact[i]) / max(static_cast<double>(exact[i]), 1.0);
+            if (estimate.lowGuess <= exact[i] && exact[i] <= estimate.highGuess) ++withinSpread;
+            nodesVisited += estimate.nodesVisited;
+        }
+        cout << "Estimate depth " << depth << " | time: " << estimateTime / 1000.0 << " ms"
+             << " | mean relative error: " << totalError / queries.size()
+             << " | within spread: " << 100.0 * withinSpread / queries.size() << "%"
+             << " | nodes per query: " << static_cast<double>(nodesVisited) / queries.size() << endl;
+    }
+    cout << endl;
+}
+
+void report(RStarTree<>& tree, const string& analysis){
     cout << "Tree info" << endl;
     cout << "   Dimension: " << tree.dimensions << endl;
     cout << "   Capacity: " << tree.maxEntries << endl;
     cout << "   Min capacity: " << tree.minEntries << endl << endl;
     cout << "   Size in MB: " << tree.calculateSizeInMB() << endl << endl;
+
+    if (!analysis.empty()) {
+        TreeStats stats = tree.analyze();
+        if (analysis == "csv") cout << stats.toCSV();
+        else if (analysis == "json") cout << stats.toJSON() << endl;
+        else stats.print(cout);
+        // Query windows in performQueries span about a fifth of the data range
+        Rectangle space = tree.nodeMBR(tree.root);
+        vector<float> querySize(tree.dimensions);
+        for (int d = 0; d < tree.dimensions; ++d)
+            querySize[d] = (space.maxCoords[d] - space.minCoords[d]) / 5.0F;
+        cout << "   Expected node accesses per query: " << tree.expectedNodeAccesses(querySize) << endl << endl;
+    }
     cout << "-------------------------" << endl << endl;
 }
 
@@ -264,14 +334,16 @@ int main(int argc, char* argv[]) {
     int capacity = 128;
     int numData = 10000;
     int numQueries = 1000;
+    bool pointData = false;
+    string analysis;
     bool validateResults = false;
     int spaceMax = 100000;
     string streamFile = "streams/WILDFIRES.stream";
 
-    parseArguments(argc, argv, numData, numQueries, dimension, capacity, validateResults, streamFile);
+    parseArguments(argc, argv, numData, numQueries, dimension, capacity, pointData, analysis, validateResults, streamFile);
 
     // Read data from the specified stream file
-    vector<Rectangle> dataPoints = readStreamFile(streamFile);
+    vector<Object<>> dataPoints = readStreamFile(streamFile);
     
     // Update numData based on actual data points read
     numData = dataPoints.size();
@@ -282,22 +354,25 @@ int main(int argc, char* argv[]) {
     }
 
     cout << "*Test: Insertion*" << endl;
-    RStarTree treeOneByOne(capacity, dimension);
+    RStarTree<> treeOneByOne(capacity, dimension, pointData);
     insert(treeOneByOne, dataPoints);
     performQueries(treeOneByOne, dataPoints, numQueries, spaceMax, validateResults);
-    report(treeOneByOne);
+    report(treeOneByOne, analysis);
 
     cout << "*Test: Batch insertion*" << endl;
-    RStarTree treeBatch(capacity, dimension);
+    RStarTree<> treeBatch(capacity, dimension, pointData);
     insertBatches(treeBatch, dataPoints, capacity);
     performQueries(treeBatch, dataPoints, numQueries, spaceMax, validateResults);
-    report(treeBatch);
+    report(treeBatch, analysis);
 
     cout << "*Test: Bulk loading*" << endl;
-    RStarTree treeBulk(capacity, dimension);
+    RStarTree<> treeBulk(capacity, dimension, pointData);
     insertBulkLoad(treeBulk, dataPoints);
     performQueries(treeBulk, dataPoints, numQueries, spaceMax, validateResults);
-    report(treeBulk);
+    report(treeBulk, analysis);
+
+    cout << "*Test: Selectivity estimation*" << endl;
+    performEstimates(treeBulk, numQueries);
 
     cout << endl << "Benchmark completed." << endl << endl;
     return 0;
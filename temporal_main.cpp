@@ -0,0 +1,258 @@
+/*
+=====================================================================
+R*-Tree Demo: Time-travel queries
+=====================================================================
+
+What does it test?
+    MultiVersionRStarTree: "what was in this region at time t" and
+    "what was in this region during [from, to)" on one versioned tree.
+
+What does it do?
+    - Simulates objects that appear, move (a removal and an insertion
+      at the same time), and disappear over a number of timestamps.
+    - Builds the multiversion tree and, as the usual workaround, one
+      bulk loaded R*-Tree per timestamp, and reports the build time and
+      memory of both.
+    - Runs range queries at past timestamps on both, plus interval
+      queries on the multiversion tree.
+    - Validates every query against the recorded versions (with -v).
+
+Command-line arguments:
+    - `-n` / `--numData`: Number of objects alive at the start (default: 100000).
+    - `-s` / `--steps`: Number of timestamps (default: 100).
+    - `-u` / `--updates`: Fraction of the objects updated per timestamp (default: 0.05).
+    - `-q` / `--numQueries`: Number of queries of each kind (default: 1000).
+    - `-c` / `--capacity`: Node capacity (default: 64).
+    - `-v` / `--validate`: Validate query results (default: off).
+=====================================================================
+ */
+
+#include "MultiVersionRStarTree.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+
+using namespace chrono;
+
+typedef MultiVersionRStarTree<>::Timestamp Timestamp;
+
+// One version of an object: its box while it was alive in [start, end)
+struct Version {
+    Object<> object;
+    Timestamp start;
+    Timestamp end;
+};
+
+struct Operation {
+    bool insert;
+    Object<> object;
+    Timestamp time;
+};
+
+void parseArguments(int argc, char* argv[], int& numData, int& steps, double& updates, int& numQueries, int& capacity, bool& validateResults) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-n" || arg == "--numData") {
+            if (i + 1 < argc) numData = atoi(argv[++i]);
+        } else if (arg == "-s" || arg == "--steps") {
+            if (i + 1 < argc) steps = atoi(argv[++i]);
+        } else if (arg == "-u" || arg == "--updates") {
+            if (i + 1 < argc) updates = atof(argv[++i]);
+        } else if (arg == "-q" || arg == "--numQueries") {
+            if (i + 1 < argc) numQueries = atoi(argv[++i]);
+        } else if (arg == "-c" || arg == "--capacity") {
+            if (i + 1 < argc) capacity = atoi(argv[++i]);
+        } else if (arg == "-v" || arg == "--validate") {
+            validateResults = true;
+        } else {
+            cout << "Usage: " << argv[0] << " [options]\n";
+            cout << "Options:\n";
+            cout << "  -n, --numData <num>       Number of objects alive at the start (default: 100000)\n";
+            cout << "  -s, --steps <num>         Number of timestamps (default: 100)\n";
+            cout << "  -u, --updates <fraction>  Fraction of the objects updated per timestamp (default: 0.05)\n";
+            cout << "  -q, --numQueries <num>    Number of queries of each kind (default: 1000)\n";
+            cout << "  -c, --capacity <num>      Node capacity of the R*-Tree (default: 64)\n";
+            cout << "  -v, --validate            Enable brute-force validation (default: off)\n";
+            exit(0);
+        }
+    }
+}
+
+Object<> randomObject(int64_t id, mt19937& gen) {
+    uniform_real_distribution<float> coord(0.0F, 100000.0F), size(0.0F, 20.0F);
+    float x = coord(gen), y = coord(gen);
+    return Object<>(id, {x, y}, {x + size(gen), y + size(gen)});
+}
+
+// Updates are moves (most of them), removals, and new objects, in time order
+void simulate(int numData, int steps, double updates, vector<Operation>& operations, vector<Version>& versions) {
+    mt19937 gen(42);
+    vector<size_t> alive; // Indexes into versions
+    for (int64_t id = 0; id < numData; ++id) {
+        versions.push_back({randomObject(id, gen), 0, MultiVersionRStarTree<>::OPEN});
+        operations.push_back({true, versions.back().object, 0});
+        alive.push_back(versions.size() - 1);
+    }
+    int64_t nextId = numData;
+
+    for (Timestamp t = 1; t < steps; ++t) {
+        size_t count = static_cast<size_t>(updates * numData);
+        for (size_t u = 0; u < count && !alive.empty(); ++u) {
+            size_t slot = gen() % alive.size();
+            int kind = gen() % 10;
+            if (kind == 0) {
+                // A new object
+                versions.push_back({randomObject(nextId++, gen), t, MultiVersionRStarTree<>::OPEN});
+                operations.push_back({true, versions.back().object, t});
+                alive.push_back(versions.size() - 1);
+                continue;
+            }
+            Version& old = versions[alive[slot]];
+            old.end = t;
+            operations.push_back({false, old.object, t});
+            if (kind == 1) {
+                // The object disappears
+                alive[slot] = alive.back();
+                alive.pop_back();
+                continue;
+            }
+            // The object moves a short distance
+            uniform_real_distribution<float> step(-500.0F, 500.0F);
+            Object<> moved = old.object;
+            float dx = step(gen), dy = step(gen);
+            moved.minCoords[0] += dx;
+            moved.maxCoords[0] += dx;
+            moved.minCoords[1] += dy;
+            moved.maxCoords[1] += dy;
+            versions.push_back({moved, t, MultiVersionRStarTree<>::OPEN});
+            operations.push_back({true, moved, t});
+            alive[slot] = versions.size() - 1;
+        }
+    }
+}
+
+vector<int64_t> ids(const vector<Object<>>& objects) {
+    vector<int64_t> result;
+    for (const auto& object : objects)
+        result.push_back(object.payload);
+    sort(result.begin(), result.end());
+    return result;
+}
+
+// Versions intersecting the box that were alive at some time in [from, to), one id per version.
+// An object moved twice at the same time leaves an empty version, which was never alive.
+vector<int64_t> scanVersions(const vector<Version>& versions, const Rectangle& box, Timestamp from, Timestamp to) {
+    vector<int64_t> result;
+    for (const auto& version : versions)
+        if (version.start < version.end && version.start < to && from < version.end && box.overlapCheck(version.object))
+            result.push_back(version.object.payload);
+    sort(result.begin(), result.end());
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    int numData = 100000;
+    int steps = 100;
+    double updates = 0.05;
+    int numQueries = 1000;
+    int capacity = 64;
+    bool validateResults = false;
+
+    parseArguments(argc, argv, numData, steps, updates, numQueries, capacity, validateResults);
+
+    vector<Operation> operations;
+    vector<Version> versions;
+    simulate(numData, steps, updates, operations, versions);
+    cout << "Objects at the start: " << numData << " | timestamps: " << steps << " | versions: " << versions.size()
+         << " | operations: " << operations.size() << endl << endl;
+
+    MultiVersionRStarTree<> tree(capacity, 2);
+    auto start = high_resolution_clock::now();
+    size_t missing = 0;
+    for (const auto& operation : operations) {
+        if (operation.insert)
+            tree.insert(operation.object, operation.time);
+        else if (!tree.remove(operation.object, operation.time))
+            ++missing;
+    }
+    double buildTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+    cout << "Multiversion tree build time: " << buildTime << " s | size: " << tree.calculateSizeInMB() << " MB"
+         << " | nodes: " << tree.nodes.size() << " | roots: " << tree.roots.size() << endl;
+    cout << "   Version splits: " << tree.versionSplits << " | key splits: " << tree.keySplits << " | merges: " << tree.merges << endl;
+    if (missing > 0)
+        cout << "Error: " << missing << " removals did not find their object" << endl;
+
+    // The workaround: one tree per timestamp, bulk loaded from the objects alive then
+    vector<unique_ptr<RStarTree<>>> snapshots;
+    start = high_resolution_clock::now();
+    float snapshotSize = 0.0F;
+    for (Timestamp t = 0; t < steps; ++t) {
+        vector<Object<>> current;
+        for (const auto& version : versions)
+            if (version.start <= t && t < version.end) current.push_back(version.object);
+        snapshots.emplace_back(new RStarTree<>(capacity, 2));
+        snapshots.back()->bulkLoad(current);
+        snapshotSize += snapshots.back()->calculateSizeInMB();
+    }
+    double snapshotTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+    cout << "Per-snapshot trees build time: " << snapshotTime << " s | size: " << snapshotSize << " MB" << endl << endl;
+
+    mt19937 gen(7);
+    uniform_real_distribution<float> corner(0.0F, 100000.0F), side(100.0F, 5000.0F);
+    vector<Rectangle> boxes;
+    vector<Timestamp> times, ends;
+    for (int i = 0; i < numQueries; ++i) {
+        float x = corner(gen), y = corner(gen);
+        boxes.emplace_back(vector<float>{x, y}, vector<float>{x + side(gen), y + side(gen)});
+        times.push_back(gen() % steps);
+        ends.push_back(times.back() + 1 + gen() % 10);
+    }
+
+    bool allQueriesMatch = missing == 0;
+    size_t results = 0;
+    start = high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+        results += tree.rangeQuery(boxes[i], times[i]).size();
+    double queryTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+    cout << "Multiversion point-in-time query time: " << queryTime << " s (" << results << " results)" << endl;
+
+    results = 0;
+    start = high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+        results += snapshots[times[i]]->rangeQuery(boxes[i]).size();
+    queryTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+    cout << "Per-snapshot query time: " << queryTime << " s (" << results << " results)" << endl;
+
+    results = 0;
+    start = high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+        results += tree.rangeQuery(boxes[i], times[i], ends[i]).size();
+    queryTime = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000000.0;
+    cout << "Multiversion interval query time: " << queryTime << " s (" << results << " versions)" << endl;
+
+    if (validateResults) {
+        for (int i = 0; i < numQueries; ++i) {
+            vector<int64_t> expected = scanVersions(versions, boxes[i], times[i], times[i] + 1);
+            vector<int64_t> found = ids(tree.rangeQuery(boxes[i], times[i]));
+            vector<int64_t> snapshot = ids(snapshots[times[i]]->rangeQuery(boxes[i]));
+            vector<int64_t> interval = ids(tree.rangeQuery(boxes[i], times[i], ends[i]));
+            vector<int64_t> expectedInterval = scanVersions(versions, boxes[i], times[i], ends[i]);
+            if (found != expected || snapshot != expected || interval != expectedInterval) {
+                cout << "Query at time " << times[i] << ": " << found.size() << " | snapshot: " << snapshot.size()
+                     << " | expected: " << expected.size() << " | interval: " << interval.size()
+                     << " | expected: " << expectedInterval.size() << endl;
+                allQueriesMatch = false;
+            }
+        }
+        // No version is alive at OPEN, the end of the versions that still are
+        Rectangle everything(vector<float>{0.0F, 0.0F}, vector<float>{100000.0F, 100000.0F});
+        if (!tree.rangeQuery(everything, MultiVersionRStarTree<>::OPEN).empty()) {
+            cout << "Query at time OPEN returned versions" << endl;
+            allQueriesMatch = false;
+        }
+        cout << (allQueriesMatch ? "All queries matched!" : "Some queries did not match!") << endl;
+    }
+    cout << endl << "Benchmark completed." << endl << endl;
+    return allQueriesMatch ? 0 : 1;
+}